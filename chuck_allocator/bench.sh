@@ -0,0 +1,10 @@
+#!/bin/bash
+
+set -e
+
+g++ -std=c++17 -O2 -pthread -I./src bench/bench.cpp -o allocator_bench
+g++ -std=c++17 -O2 -pthread -I./src bench/patterns.cpp -o allocator_patterns
+./allocator_bench
+./allocator_patterns
+
+rm allocator_bench allocator_patterns
@@ -0,0 +1,279 @@
+#include <sys/resource.h>
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <memory_resource>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include "allocator.h"
+#include "chunk_resource.h"
+#include "concurrent_allocator.h"
+#include "mmap_chunk_source.h"
+
+using namespace task;
+
+// Allocation the way it was done before the bump cursor: walk the whole chunk
+// list from the first chunk looking for enough free space
+char* walk_allocate(Chunk*& first_chunk, size_t requested_bytes) {
+    Chunk* chunk = first_chunk;
+    Chunk* prev = nullptr;
+    while (chunk != nullptr && chunk->free_space() < requested_bytes) {
+        prev = chunk;
+        chunk = chunk->next;
+    }
+    if (chunk == nullptr) {
+        chunk = Chunk::create(MAX_SMALL_SIZE);
+        if (prev == nullptr)
+            first_chunk = chunk;
+        else
+            prev->next = chunk;
+    }
+    char* res = chunk->start;
+    chunk->start += requested_bytes;
+    return res;
+}
+
+double walk_allocations_per_sec(size_t live_chunks, size_t measured) {
+    // Full chunks are linked directly, walking them here would be quadratic
+    Chunk* first_chunk = nullptr;
+    for (size_t i = 0; i < live_chunks; ++i) {
+        Chunk* chunk = Chunk::create(MAX_SMALL_SIZE);
+        chunk->start += MAX_SMALL_SIZE;
+        chunk->next = first_chunk;
+        first_chunk = chunk;
+    }
+
+    auto begin = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < measured; ++i)
+        walk_allocate(first_chunk, MAX_SMALL_SIZE);
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - begin;
+
+    while (first_chunk != nullptr) {
+        Chunk* temp = first_chunk->next;
+        Chunk::destroy(first_chunk);
+        first_chunk = temp;
+    }
+    return measured / elapsed.count();
+}
+
+double cursor_allocations_per_sec(size_t live_chunks, size_t measured) {
+    // Fixed-size chunks filled by a single allocation each
+    Allocator<char> al(MAX_SMALL_SIZE, MAX_SMALL_SIZE);
+    for (size_t i = 0; i < live_chunks; ++i)
+        al.allocate(MAX_SMALL_SIZE);
+
+    auto begin = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < measured; ++i)
+        al.allocate(MAX_SMALL_SIZE);
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - begin;
+    return measured / elapsed.count();
+}
+
+// Baseline for the concurrent mode: one Allocator behind a mutex
+template<class T>
+class MutexAllocator {
+public:
+    T* allocate(size_t n) {
+        std::lock_guard<std::mutex> lock(*mutex);
+        return al.allocate(n);
+    }
+
+    void deallocate(T* p, size_t n) {
+        std::lock_guard<std::mutex> lock(*mutex);
+        al.deallocate(p, n);
+    }
+
+private:
+    Allocator<T> al;
+    std::shared_ptr<std::mutex> mutex = std::make_shared<std::mutex>();
+};
+
+// Every thread keeps LIVE blocks and replaces the oldest one on each step
+template<class Alloc>
+double churn_ops_per_sec(Alloc& al, size_t threads, size_t ops_per_thread) {
+    const size_t LIVE = 64;
+    auto work = [ops_per_thread](Alloc& thread_al) {
+        std::vector<long*> live(LIVE, nullptr);
+        for (size_t i = 0; i < ops_per_thread; ++i) {
+            long*& slot = live[i % LIVE];
+            if (slot != nullptr)
+                thread_al.deallocate(slot, 2);
+            slot = thread_al.allocate(2);
+        }
+        for (long* p : live)
+            thread_al.deallocate(p, 2);
+    };
+
+    // Copies are made here, the plain Allocator does not count its copies atomically
+    std::vector<Alloc> copies(threads, al);
+    auto begin = std::chrono::steady_clock::now();
+    std::vector<std::thread> workers;
+    for (size_t i = 0; i < threads; ++i)
+        workers.emplace_back(work, std::ref(copies[i]));
+    for (auto& worker : workers)
+        worker.join();
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - begin;
+    return threads * ops_per_thread / elapsed.count();
+}
+
+// One thread moving blocks between two pools, as a pipeline stage handing
+// objects from an input pool to an output pool does
+double alternating_ops_per_sec(size_t ops) {
+    ConcurrentAllocator<long> input;
+    ConcurrentAllocator<long> output;
+    auto begin = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < ops; ++i) {
+        long* p = input.allocate(2);
+        long* q = output.allocate(2);
+        input.deallocate(p, 2);
+        output.deallocate(q, 2);
+    }
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - begin;
+    return 4 * ops / elapsed.count();
+}
+
+// One round of mixed pmr containers drawing from the same resource
+void pmr_round(std::pmr::memory_resource* resource) {
+    const int COUNT = 100000;
+    std::pmr::vector<int> numbers(resource);
+    std::pmr::unordered_map<int, std::pmr::string> names(resource);
+    for (int i = 0; i < COUNT; ++i) {
+        numbers.push_back(i);
+        names.emplace(i, std::pmr::string("name that does not fit the small buffer", resource));
+    }
+    for (int i = 0; i < COUNT; i += 2)
+        names.erase(i);
+    for (int i = 0; i < COUNT / 2; ++i)
+        names.emplace(COUNT + i, std::pmr::string("another name that does not fit the buffer", resource));
+}
+
+template<class Resource>
+double pmr_rounds_per_sec(size_t rounds) {
+    auto begin = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < rounds; ++i) {
+        Resource resource;
+        pmr_round(&resource);
+    }
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - begin;
+    return rounds / elapsed.count();
+}
+
+long minor_page_faults() {
+    rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_minflt;
+}
+
+struct Node {
+    long payload[8];
+};
+
+// Fills TOTAL bytes with touched 64-byte blocks from chunks of the given source
+void fill_from_source(const char* name, ChunkSource& source) {
+    const size_t TOTAL = 256 << 20;
+
+    long faults = minor_page_faults();
+    auto begin = std::chrono::steady_clock::now();
+    {
+        Allocator<Node> al(source);
+        for (size_t i = 0; i < TOTAL / sizeof(Node); ++i)
+            al.allocate(1)->payload[0] = i;
+    }
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - begin;
+    std::cout << name << '\t' << TOTAL / sizeof(Node) / elapsed.count() << '\t'
+              << minor_page_faults() - faults << '\n';
+}
+
+// Random inserts and erases on a map holding about half of KEYS keys
+template<class Alloc>
+double map_ops_per_sec(size_t ops) {
+    const int KEYS = 100000;
+    std::map<int, int, std::less<int>, Alloc> m;
+    std::mt19937 rand(42);
+    std::uniform_int_distribution<int> key(0, KEYS - 1);
+
+    auto begin = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < ops; ++i) {
+        if (i % 2 == 0)
+            m.emplace(key(rand), 0);
+        else
+            m.erase(key(rand));
+    }
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - begin;
+    return ops / elapsed.count();
+}
+
+void bench_walk() {
+    const size_t MEASURED = 100;
+
+    std::cout << "live chunks\twalk allocs/sec\tcursor allocs/sec\n";
+    for (size_t live_chunks = 1000; live_chunks <= 1000000; live_chunks *= 10) {
+        std::cout << live_chunks << '\t'
+                  << walk_allocations_per_sec(live_chunks, MEASURED) << '\t'
+                  << cursor_allocations_per_sec(live_chunks, MEASURED) << '\n';
+    }
+}
+
+void bench_threads() {
+    const size_t OPS_PER_THREAD = 1000000;
+    size_t max_threads = std::max(4u, std::thread::hardware_concurrency());
+
+    std::cout << "threads\tmutex ops/sec\tconcurrent ops/sec\n";
+    for (size_t threads = 1; threads <= max_threads; threads *= 2) {
+        MutexAllocator<long> mutex_al;
+        ConcurrentAllocator<long> concurrent_al;
+        std::cout << threads << '\t'
+                  << churn_ops_per_sec(mutex_al, threads, OPS_PER_THREAD) << '\t'
+                  << churn_ops_per_sec(concurrent_al, threads, OPS_PER_THREAD) << '\n';
+    }
+    std::cout << "two pools in one thread\t-\t" << alternating_ops_per_sec(OPS_PER_THREAD) << '\n';
+}
+
+void bench_pmr() {
+    const size_t ROUNDS = 10;
+
+    std::cout << "resource\trounds/sec\n";
+    std::cout << "monotonic_buffer_resource\t"
+              << pmr_rounds_per_sec<std::pmr::monotonic_buffer_resource>(ROUNDS) << '\n';
+    std::cout << "unsynchronized_pool_resource\t"
+              << pmr_rounds_per_sec<std::pmr::unsynchronized_pool_resource>(ROUNDS) << '\n';
+    std::cout << "ChunkResource\t" << pmr_rounds_per_sec<ChunkResource>(ROUNDS) << '\n';
+}
+
+void bench_chunk_sources() {
+    std::cout << "chunk source\tallocs/sec\tminor page faults\n";
+    fill_from_source("new", default_chunk_source());
+    {
+        MmapChunkSource source;
+        fill_from_source("mmap", source);
+    }
+    {
+        MmapChunkSource source(REGION_SIZE, true);
+        fill_from_source("mmap huge pages", source);
+    }
+}
+
+void bench_map() {
+    const size_t OPS = 2000000;
+    using Value = std::pair<const int, int>;
+
+    std::cout << "allocator\tmap ops/sec\n";
+    std::cout << "std::allocator\t" << map_ops_per_sec<std::allocator<Value>>(OPS) << '\n';
+    std::cout << "Allocator\t" << map_ops_per_sec<Allocator<Value>>(OPS) << '\n';
+    std::cout << "SlabAllocator\t" << map_ops_per_sec<SlabAllocator<Value>>(OPS) << '\n';
+}
+
+int main() {
+    bench_walk();
+    bench_threads();
+    bench_pmr();
+    bench_chunk_sources();
+    bench_map();
+    return 0;
+}
@@ -0,0 +1,308 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <list>
+#include <map>
+#include <memory>
+#include <memory_resource>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+#include "allocator.h"
+#include "chunk_resource.h"
+#include "concurrent_allocator.h"
+
+using namespace task;
+using Clock = std::chrono::steady_clock;
+
+// Allocation latencies in nanoseconds, everything slower lands in the last bucket
+struct LatencyLog {
+    static const size_t NUM_OF_BUCKETS = 10000;
+    size_t buckets[NUM_OF_BUCKETS] = {};
+    size_t count = 0;
+
+    void record(Clock::duration latency) {
+        size_t ns = std::chrono::duration_cast<std::chrono::nanoseconds>(latency).count();
+        ++buckets[std::min(ns, NUM_OF_BUCKETS - 1)];
+        ++count;
+    }
+
+    void merge(const LatencyLog& other) {
+        for (size_t i = 0; i < NUM_OF_BUCKETS; ++i)
+            buckets[i] += other.buckets[i];
+        count += other.count;
+    }
+
+    size_t percentile(double p) const {
+        size_t rank = static_cast<size_t>(p * count);
+        size_t seen = 0;
+        for (size_t i = 0; i < NUM_OF_BUCKETS; ++i) {
+            seen += buckets[i];
+            if (seen > rank)
+                return i;
+        }
+        return NUM_OF_BUCKETS - 1;
+    }
+};
+
+// Bytes held by the pattern, shared by all its threads
+struct Usage {
+    std::atomic<long> live_bytes{ 0 };
+    std::atomic<long> peak_live_bytes{ 0 };
+
+    void add(long bytes) {
+        long live = live_bytes.fetch_add(bytes, std::memory_order_relaxed) + bytes;
+        long peak = peak_live_bytes.load(std::memory_order_relaxed);
+        while (live > peak && !peak_live_bytes.compare_exchange_weak(peak, live, std::memory_order_relaxed)) {}
+    }
+};
+
+// Wraps any allocator, timing every allocate() and tracking the live bytes
+template<class T, class Base>
+class TimedAllocator {
+public:
+    using value_type = T;
+    using BaseT = typename std::allocator_traits<Base>::template rebind_alloc<T>;
+
+    template<class U>
+    struct rebind {
+        typedef TimedAllocator<U, Base> other;
+    };
+
+    TimedAllocator(const Base& base, LatencyLog* log, Usage* usage) : base(base), log(log), usage(usage) {}
+
+    template<class U>
+    TimedAllocator(const TimedAllocator<U, Base>& other) : base(other.base), log(other.log), usage(other.usage) {}
+
+    T* allocate(size_t n) {
+        auto begin = Clock::now();
+        T* p = base.allocate(n);
+        log->record(Clock::now() - begin);
+        usage->add(n * sizeof(T));
+        return p;
+    }
+
+    void deallocate(T* p, size_t n) {
+        usage->add(-static_cast<long>(n * sizeof(T)));
+        base.deallocate(p, n);
+    }
+
+    template<class U>
+    bool operator==(const TimedAllocator<U, Base>& other) const {
+        return base == other.base;
+    }
+
+    template<class U>
+    bool operator!=(const TimedAllocator<U, Base>& other) const {
+        return !(*this == other);
+    }
+
+    BaseT base;
+    LatencyLog* log;
+    Usage* usage;
+};
+
+template<class Alloc, class T>
+using Rebound = typename std::allocator_traits<Alloc>::template rebind_alloc<T>;
+
+template<class Alloc>
+void vector_growth(const Alloc& al) {
+    for (int round = 0; round < 50; ++round) {
+        std::vector<int, Rebound<Alloc, int>> v(al);
+        for (int i = 0; i < 100000; ++i)
+            v.push_back(i);
+    }
+}
+
+template<class Alloc>
+void list_churn(const Alloc& al) {
+    std::list<long, Rebound<Alloc, long>> l(al);
+    for (long i = 0; i < 2000000; ++i) {
+        l.push_back(i);
+        if (l.size() > 10000)
+            l.pop_front();
+    }
+}
+
+template<class Alloc>
+void map_churn(const Alloc& al) {
+    using Value = std::pair<const int, long>;
+    std::map<int, long, std::less<int>, Rebound<Alloc, Value>> m(al);
+    std::mt19937 rand(42);
+    std::uniform_int_distribution<int> key(0, 99999);
+    for (int i = 0; i < 1000000; ++i) {
+        m.emplace(key(rand), i);
+        m.erase(key(rand));
+    }
+}
+
+// Many blocks of mixed sizes allocated at once and freed in random order
+template<class Alloc>
+void burst_then_free(const Alloc& al) {
+    const size_t BURST = 50000;
+    Rebound<Alloc, char> bytes(al);
+    std::mt19937 rand(42);
+    std::uniform_int_distribution<size_t> size(16, 512);
+    std::vector<std::pair<char*, size_t>> blocks(BURST);
+    for (int round = 0; round < 20; ++round) {
+        for (auto& block : blocks) {
+            block.second = size(rand);
+            block.first = bytes.allocate(block.second);
+            block.first[0] = 1;
+        }
+        std::shuffle(blocks.begin(), blocks.end(), rand);
+        for (auto& block : blocks)
+            bytes.deallocate(block.first, block.second);
+    }
+}
+
+struct Message {
+    long payload[8];
+};
+
+const size_t RING = 1024;
+
+// Single-producer single-consumer ring of messages
+struct Channel {
+    Message* ring[RING];
+    std::atomic<size_t> head{ 0 };
+    std::atomic<size_t> tail{ 0 };
+};
+
+// Pairs of threads: producers allocate messages, consumers free them
+template<class Alloc>
+void producer_consumer(const Alloc& al, std::vector<LatencyLog>& logs) {
+    const size_t PAIRS = 2;
+    const size_t MESSAGES = 1000000;
+
+    std::vector<Channel> channels(PAIRS);
+    std::vector<Rebound<Alloc, Message>> copies;
+    for (size_t i = 0; i < 2 * PAIRS; ++i)
+        copies.emplace_back(Rebound<Alloc, Message>(al.base, &logs[i], al.usage));
+
+    std::vector<std::thread> threads;
+    for (size_t pair = 0; pair < PAIRS; ++pair) {
+        Channel& channel = channels[pair];
+        auto& producer_al = copies[2 * pair];
+        auto& consumer_al = copies[2 * pair + 1];
+        threads.emplace_back([&channel, &producer_al] {
+            for (size_t i = 0; i < MESSAGES; ++i) {
+                Message* message = producer_al.allocate(1);
+                message->payload[0] = i;
+                size_t tail = channel.tail.load(std::memory_order_relaxed);
+                while (tail - channel.head.load(std::memory_order_acquire) == RING)
+                    std::this_thread::yield();
+                channel.ring[tail % RING] = message;
+                channel.tail.store(tail + 1, std::memory_order_release);
+            }
+        });
+        threads.emplace_back([&channel, &consumer_al] {
+            for (size_t i = 0; i < MESSAGES; ++i) {
+                size_t head = channel.head.load(std::memory_order_relaxed);
+                while (channel.tail.load(std::memory_order_acquire) == head)
+                    std::this_thread::yield();
+                consumer_al.deallocate(channel.ring[head % RING], 1);
+                channel.head.store(head + 1, std::memory_order_release);
+            }
+        });
+    }
+    for (auto& thread : threads)
+        thread.join();
+}
+
+// Memory counters of the process in KiB
+long status_kib(const std::string& field) {
+    std::ifstream status("/proc/self/status");
+    std::string line;
+    while (std::getline(status, line)) {
+        if (line.compare(0, field.size(), field) == 0)
+            return std::stol(line.substr(field.size() + 1));
+    }
+    return 0;
+}
+
+// Makes VmHWM start over from the current resident set
+void reset_peak_rss() {
+    std::ofstream("/proc/self/clear_refs") << "5";
+}
+
+void report(const std::string& pattern, const std::string& allocator, const LatencyLog& log,
+            double seconds, long peak_rss_kib, long peak_live_bytes) {
+    double fragmentation = peak_rss_kib <= 0 ? 0. :
+        std::max(0., 1. - static_cast<double>(peak_live_bytes) / (peak_rss_kib * 1024.));
+    std::cout << std::left << std::setw(20) << pattern << std::setw(30) << allocator
+              << std::setw(14) << static_cast<long>(log.count / seconds)
+              << std::setw(8) << log.percentile(0.5) << std::setw(8) << log.percentile(0.99)
+              << std::setw(14) << peak_rss_kib << std::setprecision(3) << fragmentation << '\n';
+}
+
+template<class Base, class Pattern>
+void run(const std::string& pattern_name, const std::string& allocator_name, const Base& base, Pattern pattern) {
+    LatencyLog log;
+    Usage usage;
+    long rss_before = status_kib("VmRSS:");
+    reset_peak_rss();
+
+    auto begin = Clock::now();
+    pattern(TimedAllocator<char, Base>(base, &log, &usage));
+    std::chrono::duration<double> elapsed = Clock::now() - begin;
+
+    report(pattern_name, allocator_name, log, elapsed.count(), status_kib("VmHWM:") - rss_before,
+           usage.peak_live_bytes.load());
+}
+
+template<class Base>
+void run_threads(const std::string& allocator_name, const Base& base) {
+    std::vector<LatencyLog> logs(4);
+    Usage usage;
+    long rss_before = status_kib("VmRSS:");
+    reset_peak_rss();
+
+    auto begin = Clock::now();
+    producer_consumer(TimedAllocator<char, Base>(base, &logs[0], &usage), logs);
+    std::chrono::duration<double> elapsed = Clock::now() - begin;
+
+    for (size_t i = 1; i < logs.size(); ++i)
+        logs[0].merge(logs[i]);
+    report("producer/consumer", allocator_name, logs[0], elapsed.count(),
+           status_kib("VmHWM:") - rss_before, usage.peak_live_bytes.load());
+}
+
+// Runs one pattern on every single-threaded allocator
+template<class Pattern>
+void run_all(const std::string& pattern_name, Pattern pattern) {
+    run(pattern_name, "std::allocator", std::allocator<char>(), pattern);
+    run(pattern_name, "task::Allocator", Allocator<char>(), pattern);
+    run(pattern_name, "task::SlabAllocator", SlabAllocator<char>(), pattern);
+    {
+        std::pmr::unsynchronized_pool_resource resource;
+        run(pattern_name, "unsynchronized_pool_resource", std::pmr::polymorphic_allocator<char>(&resource), pattern);
+    }
+    {
+        ChunkResource resource;
+        run(pattern_name, "task::ChunkResource", std::pmr::polymorphic_allocator<char>(&resource), pattern);
+    }
+}
+
+int main() {
+    std::cout << std::left << std::setw(20) << "pattern" << std::setw(30) << "allocator"
+              << std::setw(14) << "allocs/sec" << std::setw(8) << "p50 ns" << std::setw(8) << "p99 ns"
+              << std::setw(14) << "peak RSS KiB" << "fragmentation\n";
+
+    run_all("vector growth", [](const auto& al) { vector_growth(al); });
+    run_all("list churn", [](const auto& al) { list_churn(al); });
+    run_all("map churn", [](const auto& al) { map_churn(al); });
+    run_all("burst then free", [](const auto& al) { burst_then_free(al); });
+
+    run_threads("std::allocator", std::allocator<char>());
+    run_threads("task::ConcurrentAllocator", ConcurrentAllocator<char>());
+    {
+        std::pmr::synchronized_pool_resource resource;
+        run_threads("synchronized_pool_resource", std::pmr::polymorphic_allocator<char>(&resource));
+    }
+    return 0;
+}
@@ -1,25 +1,172 @@
+#include <deque>
+#include <list>
+#include <map>
+#include <string>
+#include <unordered_map>
+#include <vector>
 #include "allocator.h"
+#include "chunk_resource.h"
+#include "mmap_chunk_source.h"
 
 using namespace task;
 
+struct alignas(64) CacheLine {
+    char bytes[64];
+};
+
 int main() {
     Allocator<int>* al = new Allocator<int>;
     int* p = al->allocate(1); // Is allocated in the 1st chunk
     al->construct(p);
     *p = 1221;
-    int* p1 = al->allocate(2); // Is allocated in the 2nd chunk
+    int* p1 = al->allocate(2); // Is bumped right after p, blocks are rounded up to 8 bytes
     al->construct(p1);
     *p1 = -14521;
     int* p2 = p1 + 1;
     al->construct(p2);
     *p2 = 454;
-    al->allocate(1); // Is allocated in the 1st chunk
-    al->allocate(1); // Is allocated in the 3rd chunk
+    al->allocate(1);
+
+    al->destroy(p);
+    al->deallocate(p, 1);
+    int* p3 = al->allocate(1); // Reuses the block freed above
+    al->construct(p3, 7);
+
+    int* big = al->allocate(1000); // Is too big for a chunk and bypasses the pool
+    al->deallocate(big, 1000);
 
     auto* al1 = new Allocator<int>(*al);
     al->allocate(2);
     al1->allocate(1);
     delete al;
     delete al1;
+
+    Allocator<int> small_chunks(64, 1024);
+    std::vector<int, Allocator<int>> v(small_chunks);
+    for (int i = 0; i < 1000; ++i)
+        v.push_back(i);
+    const int* data = v.data();
+    std::vector<int, Allocator<int>> moved(std::move(v)); // Steals the storage and shares the pool
+    v.push_back(1);
+    if (moved.data() != data) {
+        std::cerr << "Vector move copied the storage" << std::endl;
+        return 1;
+    }
+
+    Allocator<int> source;
+    Allocator<int> target(std::move(source));
+    Allocator<int> assigned;
+    assigned = std::move(target);
+    if (source != target || target != assigned) {
+        std::cerr << "A moved-from allocator differs from the new one" << std::endl;
+        return 1;
+    }
+    source.deallocate(assigned.allocate(3), 3);
+
+    // Containers keep using the allocators they moved from
+    std::deque<int, Allocator<int>> d1, d2;
+    std::list<int, Allocator<int>> l1, l2;
+    std::vector<int, Allocator<int>> v1, v2;
+    for (int i = 0; i < 1000; ++i) {
+        d1.push_back(i);
+        l1.push_back(i);
+        v1.push_back(i);
+        d2.push_front(-i);
+        l2.push_front(-i);
+    }
+    std::deque<int, Allocator<int>> d3(std::move(d1));
+    std::list<int, Allocator<int>> l3(std::move(l1));
+    std::vector<int, Allocator<int>> v3(std::move(v1));
+    d1 = std::move(d2);
+    l1 = std::move(l2);
+    v1 = std::move(v2);
+    d1.swap(d3);
+    l1.swap(l3);
+    v1.swap(v3);
+    std::swap(d2, d3);
+    for (int i = 0; i < 100; ++i) {
+        d1.push_back(i);
+        d2.push_front(i);
+        d3.push_back(i);
+        l2.push_back(i);
+        v2.push_back(i);
+    }
+    if (d1.size() != 1100 || d2.size() != 1100 || l3.size() != 1000 || v1.size() != 1000 || v1[999] != 999) {
+        std::cerr << "Moved or swapped containers lost elements" << std::endl;
+        return 1;
+    }
+
+    std::list<int, Allocator<int>> l; // Nodes come from the same pool as the rebound allocator
+    std::map<int, int, std::less<int>, Allocator<std::pair<const int, int>>> m(l.get_allocator());
+    for (int i = 0; i < 1000; ++i) {
+        l.push_back(i);
+        m[i] = i;
+    }
+    for (int i = 0; i < 1000; i += 2)
+        m.erase(i);
+
+    std::map<int, int, std::less<int>, SlabAllocator<std::pair<const int, int>>> slab_map;
+    for (int i = 0; i < 1000; ++i)
+        slab_map[i] = i;
+    for (int i = 0; i < 1000; i += 2)
+        slab_map.erase(i);
+
+    Allocator<CacheLine> lines;
+    lines.allocate(1);
+    CacheLine* line = lines.allocate(3);
+    CacheLine* big_line = lines.allocate(100);
+    if (reinterpret_cast<uintptr_t>(line) % alignof(CacheLine) != 0 ||
+        reinterpret_cast<uintptr_t>(big_line) % alignof(CacheLine) != 0) {
+        std::cerr << "Misaligned CacheLine" << std::endl;
+        return 1;
+    }
+    lines.deallocate(big_line, 100);
+
+    Allocator<int> arena;
+    for (int request = 0; request < 100; ++request) {
+        ArenaScope<Allocator<int>> scope(arena); // Every request reuses the chunks of the first one
+        for (int i = 0; i < 2000; ++i)
+            arena.construct(arena.allocate(1), i);
+    }
+    arena.release();
+
+    MmapChunkSource small_regions(1 << 20);
+    Allocator<long> mapped(small_regions);
+    for (int round = 0; round < 50; ++round) {
+        for (int i = 0; i < 200000; ++i) // Several regions worth of chunks
+            mapped.allocate(1);
+        mapped.release(); // Only the region chunks are carved from stays mapped
+        if (small_regions.mapped_bytes() > 2 * MAX_CHUNK_SIZE) {
+            std::cerr << "Released regions are not reused" << std::endl;
+            return 1;
+        }
+    }
+
+    ChunkResource resource; // One pool for containers of all value types
+    std::pmr::vector<std::pmr::string> names(&resource);
+    std::pmr::unordered_map<int, std::pmr::string> by_id(&resource);
+    for (int i = 0; i < 100; ++i) {
+        names.emplace_back("a name long enough to avoid the small string buffer");
+        by_id.emplace(i, names.back());
+    }
+#ifdef TASK_ALLOCATOR_STATS
+    Allocator<char> counted;
+    char* small_block = counted.allocate(3);
+    char* large_block = counted.allocate(5000);
+    if (counted.stats().requested_bytes != 5003) { // Hardening headers and red zones are not requested
+        std::cerr << "Statistics count more bytes than were requested" << std::endl;
+        return 1;
+    }
+    counted.deallocate(small_block, 3);
+    counted.reset();
+    counted.deallocate(large_block, 5000);
+    if (counted.stats().requested_bytes != 0) {
+        std::cerr << "Statistics of large blocks drift after reset()" << std::endl;
+        return 1;
+    }
+
+    resource.dump_stats_json(std::cout);
+    std::cout << std::endl;
+#endif
     return 0;
-}
\ No newline at end of file
+}
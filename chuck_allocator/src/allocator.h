@@ -1,23 +1,528 @@
 #pragma once
+#include <algorithm>
 #include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
 #include <new>
 #include <iostream>
+#include <type_traits>
+#include <unordered_set>
+#include <utility>
+
+#if defined(TASK_ALLOCATOR_HARDENING) && defined(__SANITIZE_ADDRESS__)
+#include <sanitizer/asan_interface.h>
+#define TASK_ASAN_POISON(addr, size) ASAN_POISON_MEMORY_REGION(addr, size)
+#define TASK_ASAN_UNPOISON(addr, size) ASAN_UNPOISON_MEMORY_REGION(addr, size)
+#else
+#define TASK_ASAN_POISON(addr, size) ((void)(addr), (void)(size))
+#define TASK_ASAN_UNPOISON(addr, size) ((void)(addr), (void)(size))
+#endif
 
 namespace task {
 
-    const size_t CHUNK_SIZE = 8;
+    // The first chunk of a pool has INITIAL_CHUNK_SIZE bytes, every next one
+    // is twice as big as the previous until MAX_CHUNK_SIZE is reached
+    const size_t INITIAL_CHUNK_SIZE = 4096;
+    const size_t MAX_CHUNK_SIZE = 1 << 20;
+    // Bigger requests bypass the chunks and go straight to operator new
+    const size_t MAX_SMALL_SIZE = 1024;
+    // Chunks of slabs hold at least SLAB_SIZE bytes of equal slots
+    const size_t SLAB_SIZE = 16384;
+
+    // Freed blocks are linked through their own first bytes, so every block
+    // is rounded up to hold at least one such link
+    struct FreeBlock {
+        FreeBlock* next;
+    };
+
+    const size_t BLOCK_ALIGN = sizeof(FreeBlock);
+    const size_t NUM_OF_SIZE_CLASSES = MAX_SMALL_SIZE / BLOCK_ALIGN + 1;
+
+    // Zero-byte requests still get a block big enough to be linked when freed
+    inline size_t size_class(size_t bytes) {
+        return (std::max(bytes, size_t{ 1 }) + BLOCK_ALIGN - 1) / BLOCK_ALIGN;
+    }
+
+    // Upstream the memory of chunks comes from. Returned blocks must be aligned
+    // at least as operator new aligns them
+    class ChunkSource {
+    public:
+        virtual ~ChunkSource() {}
+        virtual void* allocate_chunk(size_t bytes) = 0;
+        virtual void deallocate_chunk(void* p, size_t bytes) = 0;
+    };
+
+    class NewChunkSource : public ChunkSource {
+    public:
+        void* allocate_chunk(size_t bytes) override {
+            return ::operator new(bytes);
+        }
 
+        void deallocate_chunk(void* p, size_t) override {
+            ::operator delete(p);
+        }
+    };
+
+    inline ChunkSource& default_chunk_source() {
+        static NewChunkSource source;
+        return source;
+    }
+
+    // A chunk is a single block of memory: this header followed by size bytes
+    // handed out to the allocations
     struct Chunk {
-        Chunk() {
-            bytes = new char[CHUNK_SIZE];
-            start = bytes;
+        static Chunk* create(size_t size, ChunkSource& source = default_chunk_source()) {
+            Chunk* chunk = new(source.allocate_chunk(sizeof(Chunk) + size)) Chunk;
+            chunk->start = chunk->bytes();
+            chunk->size = size;
+            return chunk;
+        }
+
+        static void destroy(Chunk* chunk, ChunkSource& source = default_chunk_source()) {
+            size_t size = chunk->size;
+            chunk->~Chunk();
+            source.deallocate_chunk(chunk, sizeof(Chunk) + size);
         }
+
         Chunk* next = nullptr;
-        char* bytes;
+        // Links chunks of the pool's partial or empty chunks list
+        Chunk* next_partial = nullptr;
         char* start;
-        ~Chunk() {
-            delete[] bytes;
+        size_t size;
+
+        char* bytes() {
+            return reinterpret_cast<char*>(this + 1);
+        }
+
+        size_t free_space() {
+            return static_cast<size_t>(bytes() + size - start);
+        }
+
+        // Bumps start past an aligned block of the given size,
+        // returns nullptr if the rest of the chunk is too small for it
+        char* carve(size_t requested_bytes, size_t alignment) {
+            size_t padding = (alignment - reinterpret_cast<uintptr_t>(start) % alignment) % alignment;
+            if (padding + requested_bytes > free_space())
+                return nullptr;
+            char* res = start + padding;
+            start = res + requested_bytes;
+            return res;
+        }
+    };
+
+#ifdef TASK_ALLOCATOR_STATS
+    // Bucket i of the size histogram counts requests of [2^i, 2^(i+1)) bytes,
+    // the last one also takes everything bigger
+    const size_t NUM_OF_HISTOGRAM_BUCKETS = 32;
+
+    // Collected only when TASK_ALLOCATOR_STATS is defined
+    struct PoolStats {
+        size_t allocations = 0;
+        size_t deallocations = 0;
+        size_t free_list_hits = 0;
+        size_t partial_chunk_hits = 0;
+        size_t chunks_created = 0;
+        size_t large_allocations = 0;
+        // Bytes asked for by the live blocks, before rounding up to size classes
+        size_t requested_bytes = 0;
+        size_t peak_requested_bytes = 0;
+        // Bytes of the live blocks bigger than MAX_SMALL_SIZE, they survive reset()
+        size_t large_bytes = 0;
+        // The part of requested_bytes asked for by those blocks
+        size_t large_requested_bytes = 0;
+        // Bytes of all chunks plus the live large blocks
+        size_t reserved_bytes = 0;
+        size_t peak_reserved_bytes = 0;
+        size_t size_histogram[NUM_OF_HISTOGRAM_BUCKETS] = {};
+
+        void on_allocate(size_t bytes) {
+            ++allocations;
+            requested_bytes += bytes;
+            peak_requested_bytes = std::max(peak_requested_bytes, requested_bytes);
+            size_t bucket = 0;
+            while (bucket + 1 < NUM_OF_HISTOGRAM_BUCKETS && (bytes >> (bucket + 1)) != 0)
+                ++bucket;
+            ++size_histogram[bucket];
+        }
+
+        void on_deallocate(size_t bytes) {
+            ++deallocations;
+            requested_bytes -= bytes;
+        }
+
+        void on_reserve(size_t bytes) {
+            reserved_bytes += bytes;
+            peak_reserved_bytes = std::max(peak_reserved_bytes, reserved_bytes);
+        }
+    };
+
+#define TASK_ALLOCATOR_STAT(statement) statement
+#else
+#define TASK_ALLOCATOR_STAT(statement)
+#endif
+
+#ifdef TASK_ALLOCATOR_HARDENING
+    // With TASK_ALLOCATOR_HARDENING defined every block gets a header in front
+    // and a red zone behind, freed blocks are poisoned and every deallocate()
+    // is checked against the header. Violations abort the program
+    const size_t REDZONE_SIZE = 16;
+    const unsigned char REDZONE_BYTE = 0xFB;
+    const unsigned char FRESH_BYTE = 0xCD;
+    const unsigned char FREED_BYTE = 0xDD;
+    const uint64_t CANARY = 0x5AFEC0DE5AFEC0DEull;
+    const size_t BLOCK_LIVE = 0x11FE;
+    const size_t BLOCK_FREED = 0xDEAD;
+
+    struct BlockHeader {
+        // Overwritten by the free-list link once the block is freed
+        size_t size;
+        size_t state;
+        uint64_t canary;
+    };
+
+    inline size_t header_size(size_t alignment) {
+        return (sizeof(BlockHeader) + alignment - 1) / alignment * alignment;
+    }
+
+    inline size_t hardened_size(size_t bytes, size_t alignment) {
+        return header_size(alignment) + bytes + REDZONE_SIZE;
+    }
+
+    [[noreturn]] inline void hardening_failure(const char* what, void* p) {
+        std::cerr << "task::Allocator: " << what << " at " << p << std::endl;
+        std::abort();
+    }
+
+    // Lays out the header and the red zone of a raw block, returns the user bytes
+    inline void* guard_block(void* raw, size_t bytes, size_t alignment) {
+        char* user = static_cast<char*>(raw) + header_size(alignment);
+        TASK_ASAN_UNPOISON(raw, hardened_size(bytes, alignment));
+        BlockHeader* header = reinterpret_cast<BlockHeader*>(user) - 1;
+        header->size = bytes;
+        header->state = BLOCK_LIVE;
+        header->canary = CANARY;
+        std::memset(user, FRESH_BYTE, bytes);
+        std::memset(user + bytes, REDZONE_BYTE, REDZONE_SIZE);
+        TASK_ASAN_POISON(user + bytes, REDZONE_SIZE);
+        return user;
+    }
+
+    // Checks the block handed back by deallocate(), poisons it and returns the raw block.
+    // The header of a block bigger than MAX_SMALL_SIZE is gone with the block once
+    // it is freed, so the pool checks those against its set of live ones first
+    inline void* unguard_block(void* p, size_t bytes, size_t alignment) {
+        char* user = static_cast<char*>(p);
+        BlockHeader* header = reinterpret_cast<BlockHeader*>(user) - 1;
+        if (header->state == BLOCK_FREED)
+            hardening_failure("double free", p);
+        if (header->state != BLOCK_LIVE || header->canary != CANARY)
+            hardening_failure("freeing a block that is not live or whose header is corrupted", p);
+        if (header->size != bytes)
+            hardening_failure("size passed to deallocate does not match the allocation", p);
+        TASK_ASAN_UNPOISON(user + bytes, REDZONE_SIZE);
+        for (size_t i = 0; i < REDZONE_SIZE; ++i) {
+            if (static_cast<unsigned char>(user[bytes + i]) != REDZONE_BYTE)
+                hardening_failure("buffer overrun", p);
         }
+        header->state = BLOCK_FREED;
+        std::memset(user, FREED_BYTE, bytes + REDZONE_SIZE);
+        TASK_ASAN_POISON(user, bytes + REDZONE_SIZE);
+        return user - header_size(alignment);
+    }
+#endif
+
+    // Chunks holding only slots of one size class, unused slots are linked
+    struct Slab {
+        Chunk* chunk = nullptr;
+        FreeBlock* free_slots = nullptr;
+    };
+
+    // State shared by all allocators originated as copies of each other,
+    // so that any of them could destroy all chunks
+    struct Pool {
+        explicit Pool(size_t initial_chunk_size = INITIAL_CHUNK_SIZE, size_t max_chunk_size = MAX_CHUNK_SIZE,
+                      ChunkSource& source = default_chunk_source())
+            : source(source),
+              initial_chunk_size(std::max(initial_chunk_size, MAX_SMALL_SIZE)),
+              next_chunk_size(this->initial_chunk_size),
+              max_chunk_size(std::max(max_chunk_size, next_chunk_size)) {}
+
+        Pool(const Pool&) = delete;
+        Pool& operator=(const Pool&) = delete;
+
+        ChunkSource& source;
+        Chunk* first_chunk = nullptr;
+        // Chunk the allocations are bumped from
+        Chunk* current_chunk = nullptr;
+        // Chunks left by the cursor with some space still free
+        Chunk* partial_chunks = nullptr;
+        // Chunks emptied by reset(), the cursor takes them before creating new ones
+        Chunk* empty_chunks = nullptr;
+        FreeBlock* free_lists[NUM_OF_SIZE_CLASSES] = {};
+        Slab slabs[NUM_OF_SIZE_CLASSES];
+        size_t initial_chunk_size;
+        size_t next_chunk_size;
+        size_t max_chunk_size;
+        size_t num_of_allocators = 1;
+#ifdef TASK_ALLOCATOR_STATS
+        PoolStats stats;
+#endif
+#ifdef TASK_ALLOCATOR_HARDENING
+        std::unordered_set<void*> live_large_blocks;
+#endif
+
+        ~Pool() {
+            release();
+        }
+
+        // Drops one allocator's reference, true when it was the last one
+        bool unref() {
+            return --num_of_allocators == 0;
+        }
+
+        void* allocate(size_t bytes, size_t alignment) {
+#ifdef TASK_ALLOCATOR_HARDENING
+            alignment = std::max(alignment, BLOCK_ALIGN);
+            size_t raw_bytes = hardened_size(bytes, alignment);
+            void* p = guard_block(allocate_block(raw_bytes, alignment, bytes), bytes, alignment);
+            if (raw_bytes > MAX_SMALL_SIZE)
+                live_large_blocks.insert(p);
+            return p;
+#else
+            return allocate_block(bytes, alignment, bytes);
+#endif
+        }
+
+        void deallocate(void* p, size_t bytes, size_t alignment) {
+#ifdef TASK_ALLOCATOR_HARDENING
+            alignment = std::max(alignment, BLOCK_ALIGN);
+            size_t raw_bytes = hardened_size(bytes, alignment);
+            if (raw_bytes > MAX_SMALL_SIZE)
+                forget_large_block(p);
+            deallocate_block(unguard_block(p, bytes, alignment), raw_bytes, alignment, bytes);
+#else
+            deallocate_block(p, bytes, alignment, bytes);
+#endif
+        }
+
+        // Slots are only aligned to BLOCK_ALIGN, over-aligned types must use allocate()
+        void* allocate_slot(size_t bytes) {
+#ifdef TASK_ALLOCATOR_HARDENING
+            size_t raw_bytes = hardened_size(bytes, BLOCK_ALIGN);
+            if (raw_bytes > MAX_SMALL_SIZE) {
+                void* p = guard_block(allocate_block(raw_bytes, BLOCK_ALIGN, bytes), bytes, BLOCK_ALIGN);
+                live_large_blocks.insert(p);
+                return p;
+            }
+            return guard_block(allocate_slot_block(raw_bytes, bytes), bytes, BLOCK_ALIGN);
+#else
+            return allocate_slot_block(bytes, bytes);
+#endif
+        }
+
+        void deallocate_slot(void* p, size_t bytes) {
+#ifdef TASK_ALLOCATOR_HARDENING
+            size_t raw_bytes = hardened_size(bytes, BLOCK_ALIGN);
+            if (raw_bytes > MAX_SMALL_SIZE) {
+                forget_large_block(p);
+                deallocate_block(unguard_block(p, bytes, BLOCK_ALIGN), raw_bytes, BLOCK_ALIGN, bytes);
+            } else {
+                deallocate_slot_block(unguard_block(p, bytes, BLOCK_ALIGN), raw_bytes, bytes);
+            }
+#else
+            deallocate_slot_block(p, bytes, bytes);
+#endif
+        }
+#ifdef TASK_ALLOCATOR_HARDENING
+
+        void forget_large_block(void* p) {
+            if (live_large_blocks.erase(p) == 0)
+                hardening_failure("double free or freeing a large block that is not live", p);
+        }
+#endif
+
+        // The block functions take the size of the raw block and, for the
+        // statistics, the size the user asked for, smaller with hardening on
+
+        void* allocate_block(size_t bytes, size_t alignment, [[maybe_unused]] size_t requested_bytes) {
+            TASK_ALLOCATOR_STAT(stats.on_allocate(requested_bytes));
+            if (bytes > MAX_SMALL_SIZE) {
+                TASK_ALLOCATOR_STAT(++stats.large_allocations; stats.large_bytes += bytes;
+                                    stats.large_requested_bytes += requested_bytes; stats.on_reserve(bytes));
+                return ::operator new(bytes, std::align_val_t(alignment));
+            }
+            alignment = std::max(alignment, BLOCK_ALIGN);
+
+            // Reuse a freed block of the same size class before touching the chunks,
+            // unless it was freed by a type with weaker alignment
+            size_t cls = size_class(bytes);
+            if (free_lists[cls] != nullptr && reinterpret_cast<uintptr_t>(free_lists[cls]) % alignment == 0) {
+                FreeBlock* block = free_lists[cls];
+                free_lists[cls] = block->next;
+                TASK_ALLOCATOR_STAT(++stats.free_list_hits);
+                return block;
+            }
+            bytes = cls * BLOCK_ALIGN;
+
+            // Bump from the current chunk, otherwise try the most recently retired one
+            char* res = nullptr;
+            if (current_chunk != nullptr)
+                res = current_chunk->carve(bytes, alignment);
+            if (res == nullptr && partial_chunks != nullptr) {
+                Chunk* chunk = partial_chunks;
+                res = chunk->carve(bytes, alignment);
+                if (res != nullptr && chunk->free_space() < BLOCK_ALIGN)
+                    partial_chunks = chunk->next_partial;
+                TASK_ALLOCATOR_STAT(if (res != nullptr) ++stats.partial_chunk_hits);
+            }
+            if (res == nullptr)
+                res = new_current_chunk(bytes + alignment - 1)->carve(bytes, alignment);
+            return res;
+        }
+
+        void deallocate_block(void* p, size_t bytes, size_t alignment, [[maybe_unused]] size_t requested_bytes) {
+            TASK_ALLOCATOR_STAT(stats.on_deallocate(requested_bytes));
+            if (bytes > MAX_SMALL_SIZE) {
+                TASK_ALLOCATOR_STAT(stats.large_bytes -= bytes; stats.large_requested_bytes -= requested_bytes;
+                                    stats.reserved_bytes -= bytes);
+                ::operator delete(p, std::align_val_t(alignment));
+                return;
+            }
+            size_t cls = size_class(bytes);
+            FreeBlock* block = static_cast<FreeBlock*>(p);
+            block->next = free_lists[cls];
+            free_lists[cls] = block;
+        }
+
+        void* allocate_slot_block(size_t bytes, [[maybe_unused]] size_t requested_bytes) {
+            TASK_ALLOCATOR_STAT(stats.on_allocate(requested_bytes));
+            Slab& slab = slabs[size_class(bytes)];
+            if (slab.free_slots != nullptr) {
+                FreeBlock* slot = slab.free_slots;
+                slab.free_slots = slot->next;
+                TASK_ALLOCATOR_STAT(++stats.free_list_hits);
+                return slot;
+            }
+            size_t slot_size = size_class(bytes) * BLOCK_ALIGN;
+            char* res = slab.chunk != nullptr ? slab.chunk->carve(slot_size, BLOCK_ALIGN) : nullptr;
+            if (res == nullptr) {
+                slab.chunk = take_chunk(std::max(SLAB_SIZE, slot_size), slot_size);
+                res = slab.chunk->carve(slot_size, BLOCK_ALIGN);
+            }
+            return res;
+        }
+
+        void deallocate_slot_block(void* p, size_t bytes, [[maybe_unused]] size_t requested_bytes) {
+            TASK_ALLOCATOR_STAT(stats.on_deallocate(requested_bytes));
+            Slab& slab = slabs[size_class(bytes)];
+            FreeBlock* slot = static_cast<FreeBlock*>(p);
+            slot->next = slab.free_slots;
+            slab.free_slots = slot;
+        }
+
+        // Rewinds every chunk, keeping the memory for the next allocations
+        void reset() {
+            current_chunk = nullptr;
+            partial_chunks = nullptr;
+            empty_chunks = nullptr;
+            for (Chunk* chunk = first_chunk; chunk != nullptr; chunk = chunk->next) {
+                chunk->start = chunk->bytes();
+                chunk->next_partial = empty_chunks;
+                empty_chunks = chunk;
+            }
+            std::fill(free_lists, free_lists + NUM_OF_SIZE_CLASSES, nullptr);
+            std::fill(slabs, slabs + NUM_OF_SIZE_CLASSES, Slab());
+            TASK_ALLOCATOR_STAT(stats.requested_bytes = stats.large_requested_bytes);
+        }
+
+        // Returns all chunks to the system
+        void release() {
+            Chunk* chunk = first_chunk;
+            Chunk* temp;
+            while (chunk != nullptr) {
+                temp = chunk->next;
+                TASK_ASAN_UNPOISON(chunk->bytes(), chunk->size);
+                Chunk::destroy(chunk, source);
+                chunk = temp;
+            }
+            first_chunk = nullptr;
+            current_chunk = nullptr;
+            partial_chunks = nullptr;
+            empty_chunks = nullptr;
+            std::fill(free_lists, free_lists + NUM_OF_SIZE_CLASSES, nullptr);
+            std::fill(slabs, slabs + NUM_OF_SIZE_CLASSES, Slab());
+            next_chunk_size = initial_chunk_size;
+            TASK_ALLOCATOR_STAT(stats.requested_bytes = stats.large_requested_bytes; stats.reserved_bytes = stats.large_bytes);
+        }
+
+        // min_size guarantees an over-aligned block still fits after padding
+        Chunk* new_current_chunk(size_t min_size) {
+            if (current_chunk != nullptr && current_chunk->free_space() >= BLOCK_ALIGN) {
+                current_chunk->next_partial = partial_chunks;
+                partial_chunks = current_chunk;
+            }
+            // Only freshly created chunks make the next one grow
+            Chunk* old_first_chunk = first_chunk;
+            current_chunk = take_chunk(next_chunk_size, min_size);
+            if (first_chunk != old_first_chunk)
+                next_chunk_size = std::min(2 * next_chunk_size, max_chunk_size);
+            return current_chunk;
+        }
+
+        // Takes an emptied chunk of at least min_size bytes or creates a new one
+        Chunk* take_chunk(size_t size, size_t min_size) {
+            Chunk* chunk = empty_chunks;
+            if (chunk != nullptr && chunk->size >= min_size) {
+                empty_chunks = chunk->next_partial;
+                return chunk;
+            }
+            chunk = Chunk::create(std::max(size, min_size), source);
+            TASK_ALLOCATOR_STAT(++stats.chunks_created; stats.on_reserve(chunk->size));
+            chunk->next = first_chunk;
+            first_chunk = chunk;
+            return chunk;
+        }
+#ifdef TASK_ALLOCATOR_STATS
+
+        // Writes the counters together with the state of every chunk and free list
+        void dump_stats_json(std::ostream& output) {
+            size_t free_list_bytes = 0;
+            for (size_t cls = 0; cls < NUM_OF_SIZE_CLASSES; ++cls) {
+                for (FreeBlock* block = free_lists[cls]; block != nullptr; block = block->next)
+                    free_list_bytes += cls * BLOCK_ALIGN;
+                for (FreeBlock* slot = slabs[cls].free_slots; slot != nullptr; slot = slot->next)
+                    free_list_bytes += cls * BLOCK_ALIGN;
+            }
+            double fragmentation = stats.reserved_bytes == 0 ? 0. :
+                1. - static_cast<double>(stats.requested_bytes) / stats.reserved_bytes;
+
+            output << "{\"allocations\":" << stats.allocations
+                   << ",\"deallocations\":" << stats.deallocations
+                   << ",\"free_list_hits\":" << stats.free_list_hits
+                   << ",\"partial_chunk_hits\":" << stats.partial_chunk_hits
+                   << ",\"chunks_created\":" << stats.chunks_created
+                   << ",\"large_allocations\":" << stats.large_allocations
+                   << ",\"requested_bytes\":" << stats.requested_bytes
+                   << ",\"peak_requested_bytes\":" << stats.peak_requested_bytes
+                   << ",\"large_bytes\":" << stats.large_bytes
+                   << ",\"reserved_bytes\":" << stats.reserved_bytes
+                   << ",\"peak_reserved_bytes\":" << stats.peak_reserved_bytes
+                   << ",\"free_list_bytes\":" << free_list_bytes
+                   << ",\"fragmentation\":" << fragmentation
+                   << ",\"size_histogram\":[";
+            for (size_t bucket = 0; bucket < NUM_OF_HISTOGRAM_BUCKETS; ++bucket)
+                output << (bucket == 0 ? "" : ",") << stats.size_histogram[bucket];
+            output << "],\"chunks\":[";
+            for (Chunk* chunk = first_chunk; chunk != nullptr; chunk = chunk->next) {
+                output << (chunk == first_chunk ? "" : ",")
+                       << "{\"size\":" << chunk->size
+                       << ",\"used\":" << chunk->size - chunk->free_space()
+                       << ",\"free\":" << chunk->free_space() << "}";
+            }
+            output << "]}";
+        }
+#endif
     };
 
     template<class T>
@@ -31,62 +536,56 @@ namespace task {
         using size_type = size_t;
         using difference_type = ptrdiff_t;
 
+        // Copies share the pool, so containers may move their storage around
+        // in O(1) and the pool stays alive while any copy is
+        using propagate_on_container_move_assignment = std::true_type;
+        using propagate_on_container_swap = std::true_type;
+        using is_always_equal = std::false_type;
+
         template<class U>
         struct rebind {
             typedef Allocator<U> other;
         };
 
-        Allocator() {}
+        Allocator() : pool(new Pool) {}
 
-        Allocator(Allocator& other) {
-            if ((*num_of_allocators) == 1) {
-                destroy_chunks();
-            }
-            num_of_allocators = other.num_of_allocators;
-            ++(*num_of_allocators);
-            first_chunk = other.first_chunk;
+        // The chunk source must outlive the allocator and all its copies
+        explicit Allocator(size_t initial_chunk_size, size_t max_chunk_size = MAX_CHUNK_SIZE,
+                           ChunkSource& source = default_chunk_source())
+            : pool(new Pool(initial_chunk_size, max_chunk_size, source)) {}
+
+        explicit Allocator(ChunkSource& source)
+            : pool(new Pool(INITIAL_CHUNK_SIZE, MAX_CHUNK_SIZE, source)) {}
+
+        // There are no separate moves: a moved-from allocator has to stay equal
+        // to the new one, so a move shares the pool just as a copy does
+        Allocator(const Allocator& other) noexcept : pool(other.pool) {
+            ++pool->num_of_allocators;
+        }
+
+        // Containers rebind the allocator to their node types, all of them share one pool
+        template<class U>
+        Allocator(const Allocator<U>& other) noexcept : pool(other.pool) {
+            ++pool->num_of_allocators;
         }
 
         ~Allocator() {
-            if (--(*num_of_allocators) == 0)
-                destroy_chunks();
+            release_pool();
         }
 
-        Allocator& operator=(const Allocator& other) {
-            if ((*num_of_allocators) == 1) {
-                destroy_chunks();
-            }
-            num_of_allocators = other.num_of_allocators;
-            ++(*num_of_allocators);
-            first_chunk = other.first_chunk;
+        Allocator& operator=(const Allocator& other) noexcept {
+            ++other.pool->num_of_allocators;
+            release_pool();
+            pool = other.pool;
             return *this;
         }
 
         pointer allocate(size_type n) {
-            size_t requested_bytes = n * sizeof(T);
-            if (requested_bytes > CHUNK_SIZE)
-                return nullptr;
-
-            Chunk* chunk = (*first_chunk);
-            Chunk* prev = nullptr;
-            while (chunk != nullptr && static_cast<size_t>(chunk->bytes + CHUNK_SIZE - chunk->start) < requested_bytes) {
-                prev = chunk;
-                chunk = chunk->next;
-            }
-            if (chunk == nullptr) {
-                chunk = new Chunk;
-                if (prev == nullptr)
-                    (*first_chunk) = chunk;
-                else
-                    prev->next = (*chunk);
-            }
-            char* res = chunk->start;
-            chunk->start += requested_bytes;
-            return reinterpret_cast<T*>(res);
+            return static_cast<T*>(pool->allocate(n * sizeof(T), alignof(T)));
         }
 
         void deallocate(T* p, size_t n) {
-            // Do nothing    
+            pool->deallocate(p, n * sizeof(T), alignof(T));
         }
 
         template<class ... Args>
@@ -98,21 +597,106 @@ namespace task {
             p->~T();
         }
 
-    private:
-        // Store pointer to the pointer so that allocators originated as copies of each other
-        // have the same pointer to the first chunk, so that any of them could destroy all chunks
-        Chunk** first_chunk = new Chunk* { nullptr };
-        size_t* num_of_allocators = new size_t{ 1 };
+        // Both invalidate every block handed out by this allocator and its copies
+        // except the ones bigger than MAX_SMALL_SIZE, no destructors are run.
+        // reset() keeps the chunks, so the following allocations are pointer bumps
+        void reset() {
+            pool->reset();
+        }
 
-        void destroy_chunks() {
-            Chunk* chunk = (*first_chunk);
-            Chunk* temp;
-            while (chunk != nullptr) {
-                temp = chunk->next;
-                delete chunk;
-                chunk = temp;
-            }
+        void release() {
+            pool->release();
         }
+#ifdef TASK_ALLOCATOR_STATS
+
+        const PoolStats& stats() {
+            return pool->stats;
+        }
+
+        void dump_stats_json(std::ostream& output) {
+            pool->dump_stats_json(output);
+        }
+#endif
+
+        // Blocks allocated by one of two equal allocators may be deallocated by the other
+        template<class U>
+        bool operator==(const Allocator<U>& other) const noexcept {
+            return pool == other.pool;
+        }
+
+        template<class U>
+        bool operator!=(const Allocator<U>& other) const noexcept {
+            return pool != other.pool;
+        }
+
+    protected:
+        template<class U>
+        friend class Allocator;
+
+        Pool* pool;
+
+        void release_pool() {
+            Pool* p = pool;
+            pool = nullptr;
+            if (p->unref())
+                destroy(p);
+        }
+
+        // Out of line so that GCC cannot see the delete next to the count of
+        // another copy, which -Wuse-after-free takes for a use after free
+        [[gnu::noinline]] static void destroy(Pool* p) {
+            delete p;
+        }
+    };
+
+    // Allocator for node-based containers: single objects come from slabs of
+    // equal slots of their size class, with no per-object header, while arrays
+    // and over-aligned types go through the usual Allocator path
+    template<class T>
+    class SlabAllocator : public Allocator<T> {
+    public:
+        template<class U>
+        struct rebind {
+            typedef SlabAllocator<U> other;
+        };
+
+        using Allocator<T>::Allocator;
+
+        SlabAllocator() {}
+
+        template<class U>
+        SlabAllocator(const SlabAllocator<U>& other) noexcept : Allocator<T>(other) {}
+
+        T* allocate(size_t n) {
+            if (n != 1 || alignof(T) > BLOCK_ALIGN || sizeof(T) > MAX_SMALL_SIZE)
+                return Allocator<T>::allocate(n);
+            return static_cast<T*>(this->pool->allocate_slot(sizeof(T)));
+        }
+
+        void deallocate(T* p, size_t n) {
+            if (n != 1 || alignof(T) > BLOCK_ALIGN || sizeof(T) > MAX_SMALL_SIZE)
+                Allocator<T>::deallocate(p, n);
+            else
+                this->pool->deallocate_slot(p, sizeof(T));
+        }
+    };
+
+    // Resets the allocator when the scope ends, so that everything allocated
+    // within the scope is thrown away at once
+    template<class Alloc>
+    class ArenaScope {
+    public:
+        explicit ArenaScope(Alloc& allocator) : allocator(allocator) {}
+
+        ArenaScope(const ArenaScope&) = delete;
+        ArenaScope& operator=(const ArenaScope&) = delete;
+
+        ~ArenaScope() {
+            allocator.reset();
+        }
+
+    private:
+        Alloc& allocator;
     };
 } // namespace task
 
@@ -0,0 +1,57 @@
+#pragma once
+#include <memory_resource>
+#include "allocator.h"
+
+namespace task {
+
+    // Pool of chunks behind a polymorphic allocator, so that std::pmr containers
+    // of any value types draw from the same chunks
+    class ChunkResource : public std::pmr::memory_resource {
+    public:
+        ChunkResource() {}
+
+        // The chunk source must outlive the resource
+        explicit ChunkResource(size_t initial_chunk_size, size_t max_chunk_size = MAX_CHUNK_SIZE,
+                               ChunkSource& source = default_chunk_source())
+            : pool(initial_chunk_size, max_chunk_size, source) {}
+
+        explicit ChunkResource(ChunkSource& source) : pool(INITIAL_CHUNK_SIZE, MAX_CHUNK_SIZE, source) {}
+
+        ChunkResource(const ChunkResource&) = delete;
+        ChunkResource& operator=(const ChunkResource&) = delete;
+
+        // Same as Allocator::reset() and Allocator::release()
+        void reset() {
+            pool.reset();
+        }
+
+        void release() {
+            pool.release();
+        }
+#ifdef TASK_ALLOCATOR_STATS
+
+        const PoolStats& stats() const {
+            return pool.stats;
+        }
+
+        void dump_stats_json(std::ostream& output) {
+            pool.dump_stats_json(output);
+        }
+#endif
+
+    private:
+        Pool pool;
+
+        void* do_allocate(size_t bytes, size_t alignment) override {
+            return pool.allocate(bytes, alignment);
+        }
+
+        void do_deallocate(void* p, size_t bytes, size_t alignment) override {
+            pool.deallocate(p, bytes, alignment);
+        }
+
+        bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override {
+            return this == &other;
+        }
+    };
+} // namespace task
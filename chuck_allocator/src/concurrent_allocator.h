@@ -0,0 +1,260 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include "allocator.h"
+
+namespace task {
+
+    // Number of free blocks moved between a thread cache and the depot at once
+    const size_t MAGAZINE_SIZE = 32;
+    // Pools every thread finds its cache of without taking a mutex
+    const size_t CACHED_POOLS = 8;
+
+    // Free blocks and the bump chunk of one thread, touched only by that thread
+    struct ThreadCache {
+        explicit ThreadCache(std::thread::id owner, size_t next_chunk_size)
+            : owner(owner), next_chunk_size(next_chunk_size) {}
+
+        std::thread::id owner;
+        ThreadCache* next = nullptr;
+        Chunk* current_chunk = nullptr;
+        size_t next_chunk_size;
+        FreeBlock* magazines[NUM_OF_SIZE_CLASSES] = {};
+        size_t magazine_sizes[NUM_OF_SIZE_CLASSES] = {};
+    };
+
+    // Pool shared by ConcurrentAllocator copies living in different threads.
+    // Allocations are served from the calling thread's cache, only refills and
+    // flushes of whole magazines go through the depot mutex
+    struct ConcurrentPool {
+        explicit ConcurrentPool(size_t initial_chunk_size = INITIAL_CHUNK_SIZE, size_t max_chunk_size = MAX_CHUNK_SIZE)
+            : initial_chunk_size(std::max(initial_chunk_size, MAX_SMALL_SIZE)),
+              max_chunk_size(std::max(max_chunk_size, this->initial_chunk_size)) {}
+
+        ConcurrentPool(const ConcurrentPool&) = delete;
+        ConcurrentPool& operator=(const ConcurrentPool&) = delete;
+
+        ~ConcurrentPool() {
+            Chunk* chunk = first_chunk.load(std::memory_order_acquire);
+            Chunk* temp;
+            while (chunk != nullptr) {
+                temp = chunk->next;
+                Chunk::destroy(chunk);
+                chunk = temp;
+            }
+            ThreadCache* cache = caches;
+            ThreadCache* next;
+            while (cache != nullptr) {
+                next = cache->next;
+                delete cache;
+                cache = next;
+            }
+        }
+
+        // Ids tell pools apart in the thread-local lookup even if one is
+        // allocated at the address of another already destroyed pool
+        inline static std::atomic<uint64_t> next_id{ 1 };
+        const uint64_t id = next_id.fetch_add(1, std::memory_order_relaxed);
+
+        const size_t initial_chunk_size;
+        const size_t max_chunk_size;
+        std::atomic<size_t> num_of_allocators{ 1 };
+
+        // Chunks are only ever pushed while the pool is alive, so a CAS loop is enough
+        std::atomic<Chunk*> first_chunk{ nullptr };
+
+        std::mutex depot_mutex;
+        FreeBlock* depot[NUM_OF_SIZE_CLASSES] = {};
+
+        std::mutex caches_mutex;
+        ThreadCache* caches = nullptr;
+
+        ThreadCache* local_cache() {
+            struct Entry {
+                uint64_t id;
+                ThreadCache* cache;
+            };
+            thread_local Entry entries[CACHED_POOLS] = {};
+            thread_local size_t next_entry = 0;
+            for (Entry& entry : entries) {
+                if (entry.id == id)
+                    return entry.cache;
+            }
+
+            std::lock_guard<std::mutex> lock(caches_mutex);
+            std::thread::id self = std::this_thread::get_id();
+            ThreadCache* cache = caches;
+            while (cache != nullptr && cache->owner != self)
+                cache = cache->next;
+            if (cache == nullptr) {
+                cache = new ThreadCache(self, initial_chunk_size);
+                cache->next = caches;
+                caches = cache;
+            }
+            // Round robin keeps a thread alternating between a few pools from
+            // evicting the cache it is about to come back to
+            entries[next_entry] = { id, cache };
+            next_entry = (next_entry + 1) % CACHED_POOLS;
+            return cache;
+        }
+
+        // Moves up to MAGAZINE_SIZE blocks from the depot to the empty magazine
+        void refill(ThreadCache* cache, size_t cls) {
+            std::lock_guard<std::mutex> lock(depot_mutex);
+            FreeBlock* head = depot[cls];
+            if (head == nullptr)
+                return;
+            FreeBlock* tail = head;
+            size_t count = 1;
+            while (count < MAGAZINE_SIZE && tail->next != nullptr) {
+                tail = tail->next;
+                ++count;
+            }
+            depot[cls] = tail->next;
+            tail->next = nullptr;
+            cache->magazines[cls] = head;
+            cache->magazine_sizes[cls] = count;
+        }
+
+        // Moves MAGAZINE_SIZE blocks from the full magazine to the depot
+        void flush(ThreadCache* cache, size_t cls) {
+            FreeBlock* head = cache->magazines[cls];
+            FreeBlock* tail = head;
+            for (size_t i = 1; i < MAGAZINE_SIZE; ++i)
+                tail = tail->next;
+            cache->magazines[cls] = tail->next;
+            cache->magazine_sizes[cls] -= MAGAZINE_SIZE;
+
+            std::lock_guard<std::mutex> lock(depot_mutex);
+            tail->next = depot[cls];
+            depot[cls] = head;
+        }
+
+        char* carve(ThreadCache* cache, size_t requested_bytes, size_t alignment) {
+            char* res = nullptr;
+            if (cache->current_chunk != nullptr)
+                res = cache->current_chunk->carve(requested_bytes, alignment);
+            if (res != nullptr)
+                return res;
+
+            Chunk* chunk = Chunk::create(std::max(cache->next_chunk_size, requested_bytes + alignment - 1));
+            cache->next_chunk_size = std::min(2 * cache->next_chunk_size, max_chunk_size);
+            chunk->next = first_chunk.load(std::memory_order_relaxed);
+            while (!first_chunk.compare_exchange_weak(chunk->next, chunk,
+                                                      std::memory_order_release, std::memory_order_relaxed)) {}
+            cache->current_chunk = chunk;
+            return chunk->carve(requested_bytes, alignment);
+        }
+    };
+
+    // Thread-safe counterpart of Allocator: copies may be used concurrently from any threads
+    template<class T>
+    class ConcurrentAllocator {
+    public:
+        using value_type = T;
+        using pointer = T*;
+        using const_pointer = const T*;
+        using reference = T&;
+        using const_reference = const T&;
+        using size_type = size_t;
+        using difference_type = ptrdiff_t;
+
+        template<class U>
+        struct rebind {
+            typedef ConcurrentAllocator<U> other;
+        };
+
+        ConcurrentAllocator() : pool(new ConcurrentPool) {}
+
+        explicit ConcurrentAllocator(size_t initial_chunk_size, size_t max_chunk_size = MAX_CHUNK_SIZE)
+            : pool(new ConcurrentPool(initial_chunk_size, max_chunk_size)) {}
+
+        ConcurrentAllocator(const ConcurrentAllocator& other) noexcept : pool(other.pool) {
+            pool->num_of_allocators.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        template<class U>
+        ConcurrentAllocator(const ConcurrentAllocator<U>& other) noexcept : pool(other.pool) {
+            pool->num_of_allocators.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        ~ConcurrentAllocator() {
+            release();
+        }
+
+        ConcurrentAllocator& operator=(const ConcurrentAllocator& other) {
+            if (pool != other.pool) {
+                other.pool->num_of_allocators.fetch_add(1, std::memory_order_relaxed);
+                release();
+                pool = other.pool;
+            }
+            return *this;
+        }
+
+        pointer allocate(size_type n) {
+            size_t requested_bytes = n * sizeof(T);
+            if (requested_bytes > MAX_SMALL_SIZE)
+                return static_cast<T*>(::operator new(requested_bytes, std::align_val_t(alignof(T))));
+
+            size_t cls = size_class(requested_bytes);
+            ThreadCache* cache = pool->local_cache();
+            if (cache->magazines[cls] == nullptr)
+                pool->refill(cache, cls);
+            FreeBlock* block = cache->magazines[cls];
+            if (block != nullptr && reinterpret_cast<uintptr_t>(block) % ALIGNMENT == 0) {
+                cache->magazines[cls] = block->next;
+                --cache->magazine_sizes[cls];
+                return reinterpret_cast<T*>(block);
+            }
+            return reinterpret_cast<T*>(pool->carve(cache, cls * BLOCK_ALIGN, ALIGNMENT));
+        }
+
+        void deallocate(T* p, size_t n) {
+            if (n * sizeof(T) > MAX_SMALL_SIZE) {
+                ::operator delete(p, std::align_val_t(alignof(T)));
+                return;
+            }
+            size_t cls = size_class(n * sizeof(T));
+            ThreadCache* cache = pool->local_cache();
+            FreeBlock* block = reinterpret_cast<FreeBlock*>(p);
+            block->next = cache->magazines[cls];
+            cache->magazines[cls] = block;
+            if (++cache->magazine_sizes[cls] == 2 * MAGAZINE_SIZE)
+                pool->flush(cache, cls);
+        }
+
+        template<class ... Args>
+        void construct(T* p, Args&&... args) {
+            new(p) T(std::forward<Args>(args)...);
+        }
+
+        void destroy(pointer p) {
+            p->~T();
+        }
+
+        template<class U>
+        bool operator==(const ConcurrentAllocator<U>& other) const noexcept {
+            return pool == other.pool;
+        }
+
+        template<class U>
+        bool operator!=(const ConcurrentAllocator<U>& other) const noexcept {
+            return pool != other.pool;
+        }
+
+    private:
+        template<class U>
+        friend class ConcurrentAllocator;
+
+        static const size_t ALIGNMENT = alignof(T) > BLOCK_ALIGN ? alignof(T) : BLOCK_ALIGN;
+
+        ConcurrentPool* pool;
+
+        void release() {
+            if (pool->num_of_allocators.fetch_sub(1, std::memory_order_acq_rel) == 1)
+                delete pool;
+        }
+    };
+} // namespace task
@@ -0,0 +1,133 @@
+#pragma once
+#include <sys/mman.h>
+#include <unistd.h>
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include "allocator.h"
+
+namespace task {
+
+    const size_t REGION_SIZE = 64 << 20;
+
+    // Reserves big regions with mmap and carves chunks out of them, so that a big
+    // pool is backed by few mappings (optionally huge pages) instead of malloc.
+    // A region whose chunks are all deallocated is unmapped, or rewound if it is
+    // the one chunks are carved from, so pools releasing and growing again reuse
+    // the same address space. Not thread-safe, so it should not back a ConcurrentAllocator
+    class MmapChunkSource : public ChunkSource {
+    public:
+        explicit MmapChunkSource(size_t region_size = REGION_SIZE, bool huge_pages = false)
+            : region_size(region_size), huge_pages(huge_pages) {}
+
+        MmapChunkSource(const MmapChunkSource&) = delete;
+        MmapChunkSource& operator=(const MmapChunkSource&) = delete;
+
+        // Unmaps all regions, chunks of the pools using the source die with them
+        ~MmapChunkSource() override {
+            Region* region = last_region;
+            Region* prev;
+            while (region != nullptr) {
+                prev = region->prev;
+                munmap(region, region->size);
+                region = prev;
+            }
+        }
+
+        void* allocate_chunk(size_t bytes) override {
+            bytes = round_up(bytes, alignof(std::max_align_t));
+            if (last_region == nullptr || bytes > last_region->size - last_region->used)
+                map_region(bytes);
+            char* res = reinterpret_cast<char*>(last_region) + last_region->used;
+            last_region->used += bytes;
+            ++last_region->live_chunks;
+            return res;
+        }
+
+        // Gives back the physical pages completely covered by the chunk, and the
+        // whole region once its last chunk is gone
+        void deallocate_chunk(void* p, size_t bytes) override {
+            Region** link = &last_region;
+            while (!(*link)->contains(p))
+                link = &(*link)->prev;
+            Region* region = *link;
+            if (--region->live_chunks == 0 && region != last_region) {
+                *link = region->prev;
+                munmap(region, region->size);
+                return;
+            }
+            if (region->live_chunks == 0)
+                region->used = header_size();
+
+            size_t page = page_size();
+            uintptr_t begin = round_up(reinterpret_cast<uintptr_t>(p), page);
+            uintptr_t end = (reinterpret_cast<uintptr_t>(p) + bytes) / page * page;
+            if (begin < end)
+                madvise(reinterpret_cast<void*>(begin), end - begin, MADV_DONTNEED);
+        }
+
+        // Address space currently mapped for the chunks
+        size_t mapped_bytes() const {
+            size_t bytes = 0;
+            for (Region* region = last_region; region != nullptr; region = region->prev)
+                bytes += region->size;
+            return bytes;
+        }
+
+    private:
+        // Header at the front of every mapped region
+        struct Region {
+            Region* prev;
+            size_t size;
+            size_t used;
+            size_t live_chunks;
+
+            bool contains(void* p) {
+                char* begin = reinterpret_cast<char*>(this);
+                char* q = static_cast<char*>(p);
+                return begin <= q && q < begin + size;
+            }
+        };
+
+        size_t region_size;
+        bool huge_pages;
+        Region* last_region = nullptr;
+
+        static size_t page_size() {
+            static const size_t size = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+            return size;
+        }
+
+        static size_t round_up(size_t value, size_t alignment) {
+            return (value + alignment - 1) / alignment * alignment;
+        }
+
+        static size_t header_size() {
+            return round_up(sizeof(Region), alignof(std::max_align_t));
+        }
+
+        void map_region(size_t min_bytes) {
+            size_t header = header_size();
+            size_t size = round_up(std::max(region_size, header + min_bytes), page_size());
+            void* memory = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+            if (memory == MAP_FAILED)
+                throw std::bad_alloc();
+#ifdef MADV_HUGEPAGE
+            if (huge_pages)
+                madvise(memory, size, MADV_HUGEPAGE);
+#endif
+            // The tail of the previous region is abandoned, or the whole region
+            // if no chunk is left in it
+            Region* region = static_cast<Region*>(memory);
+            region->prev = last_region;
+            if (last_region != nullptr && last_region->live_chunks == 0) {
+                region->prev = last_region->prev;
+                munmap(last_region, last_region->size);
+            }
+            region->size = size;
+            region->used = header;
+            region->live_chunks = 0;
+            last_region = region;
+        }
+    };
+} // namespace task
@@ -0,0 +1,8 @@
+#!/bin/bash
+
+set -e
+
+g++ -std=c++17 -O3 -pthread -I./ bench/bench.cpp src/*.cpp -o matrix_bench
+./matrix_bench
+
+rm matrix_bench
@@ -0,0 +1,466 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <new>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include "src/fixed_matrix.h"
+#include "src/gemm.h"
+#include "src/lu.h"
+#include "src/matrix.h"
+#include "src/parallel.h"
+#include "src/serialization.h"
+#include "src/simd.h"
+#include "src/sparse.h"
+#include "src/transpose.h"
+
+using task::Matrix;
+using Clock = std::chrono::steady_clock;
+
+
+// Every heap allocation of the process, to show which operations allocate
+std::atomic<size_t> allocations{0};
+
+void* operator new(size_t size) {
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void* p = std::malloc(size)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void* operator new[](size_t size) {
+    return operator new(size);
+}
+
+void operator delete(void* p) noexcept {
+    std::free(p);
+}
+
+void operator delete[](void* p) noexcept {
+    std::free(p);
+}
+
+void operator delete(void* p, size_t) noexcept {
+    std::free(p);
+}
+
+void operator delete[](void* p, size_t) noexcept {
+    std::free(p);
+}
+
+
+Matrix RandomMatrix(size_t rows, size_t cols) {
+    static std::mt19937 rand(42);
+    std::uniform_real_distribution<double> dist{-10., 10.};
+
+    Matrix temp(rows, cols);
+    for (size_t row = 0; row < rows; ++row) {
+        for (size_t col = 0; col < cols; ++col) {
+            temp[row][col] = dist(rand);
+        }
+    }
+    return temp;
+}
+
+// Runs f until at least a fifth of a second has passed, returns seconds per run
+template<class F>
+double SecondsPerRun(F f) {
+    size_t runs = 0;
+    auto begin = Clock::now();
+    std::chrono::duration<double> elapsed{0};
+    do {
+        f();
+        ++runs;
+        elapsed = Clock::now() - begin;
+    } while (elapsed.count() < 0.2);
+    return elapsed.count() / runs;
+}
+
+
+// The textbook i-j-k loop operator*= used to be
+void NaiveMultiply(const Matrix& a, const Matrix& b, Matrix& c) {
+    for (size_t i = 0; i < a.rowsCount; ++i) {
+        for (size_t j = 0; j < b.columnsCount; ++j) {
+            double sum = 0;
+            for (size_t k = 0; k < a.columnsCount; ++k) {
+                sum += a[i][k] * b[k][j];
+            }
+            c[i][j] = sum;
+        }
+    }
+}
+
+void BenchGemm() {
+    // The naive loop needs minutes past this size
+    const size_t NAIVE_MAX_SIZE = 1024;
+
+    std::cout << "GEMM, GFLOP/s\n";
+    std::cout << std::left << std::setw(8) << "size" << std::setw(10) << "naive" << "blocked\n";
+    for (size_t n = 64; n <= 4096; n *= 2) {
+        Matrix a = RandomMatrix(n, n);
+        Matrix b = RandomMatrix(n, n);
+        Matrix c(n, n);
+        double flops = 2. * n * n * n;
+
+        std::cout << std::setw(8) << n << std::setw(10);
+        if (n <= NAIVE_MAX_SIZE) {
+            std::cout << std::setprecision(3) << flops / SecondsPerRun([&] { NaiveMultiply(a, b, c); }) * 1e-9;
+        } else {
+            std::cout << "-";
+        }
+        std::cout << flops / SecondsPerRun([&] { c = a * b; }) * 1e-9 << std::endl;
+    }
+}
+
+
+// STREAM triad over plain arrays, the bandwidth the kernels should approach
+double TriadBytesPerSec(size_t n) {
+    std::vector<double> a(n), b(n, 1.), c(n, 2.);
+    double scalar = 3.;
+    double seconds = SecondsPerRun([&] {
+        for (size_t i = 0; i < n; ++i) {
+            a[i] = b[i] + scalar * c[i];
+        }
+    });
+    return 3. * sizeof(double) * n / seconds;
+}
+
+void BenchSimd() {
+    using namespace task::simd;
+    const Isa ISAS[] = {Isa::Scalar, Isa::Sse2, Isa::Avx2, Isa::Avx512};
+
+    std::cout << "\nElement-wise ops, GB/s (detected " << isaName(detectedIsa()) << ")\n";
+    std::cout << std::left << std::setw(8) << "size" << std::setw(8) << "op";
+    for (Isa isa : ISAS) {
+        std::cout << std::setw(10) << isaName(isa);
+    }
+    std::cout << "triad\n";
+
+    // From L1-resident up to well past the last level cache
+    for (size_t n : {64, 256, 1024, 4096}) {
+        Matrix a = RandomMatrix(n, n);
+        Matrix b = a;
+        double elements = n * n;
+
+        struct Op {
+            std::string name;
+            double bytes_per_element;
+            std::function<void()> run;
+        };
+        Op ops[] = {
+            {"+=", 24, [&] { a += b; }},
+            {"*=", 16, [&] { a *= 1.0000001; }},
+            {"==", 16, [&] { volatile bool same = a == a; (void)same; }},
+        };
+        for (const Op& op : ops) {
+            std::cout << std::setw(8) << n << std::setw(8) << op.name;
+            for (Isa isa : ISAS) {
+                if (isa > detectedIsa()) {
+                    std::cout << std::setw(10) << "-";
+                    continue;
+                }
+                useIsa(isa);
+                std::cout << std::setw(10) << std::setprecision(3)
+                          << op.bytes_per_element * elements / SecondsPerRun(op.run) * 1e-9;
+            }
+            std::cout << TriadBytesPerSec(n * n) * 1e-9 << std::endl;
+        }
+    }
+    useIsa(detectedIsa());
+}
+
+void BenchScaling() {
+    const size_t GEMM_SIZE = 2048;
+    const size_t SWEEP_SIZE = 4096;
+
+    Matrix a = RandomMatrix(GEMM_SIZE, GEMM_SIZE);
+    Matrix b = RandomMatrix(GEMM_SIZE, GEMM_SIZE);
+    Matrix c;
+    Matrix x = RandomMatrix(SWEEP_SIZE, SWEEP_SIZE);
+    Matrix y = x;
+
+    std::vector<size_t> counts;
+    size_t cores = std::max(1u, std::thread::hardware_concurrency());
+    for (size_t threads = 1; threads < cores; threads *= 2) {
+        counts.push_back(threads);
+    }
+    counts.push_back(cores);
+
+    std::cout << "\nThread scaling, speedup over 1 thread in parentheses\n";
+    std::cout << std::left << std::setw(10) << "threads" << std::setw(24) << "GEMM 2048 GFLOP/s"
+              << std::setw(24) << "+= 4096 GB/s" << "== 4096 GB/s\n";
+    double base[3] = {};
+    for (size_t threads : counts) {
+        task::parallel::setThreadCount(threads);
+        double rates[3] = {
+            2. * GEMM_SIZE * GEMM_SIZE * GEMM_SIZE / SecondsPerRun([&] { c = a * b; }) * 1e-9,
+            24. * SWEEP_SIZE * SWEEP_SIZE / SecondsPerRun([&] { x += y; }) * 1e-9,
+            16. * SWEEP_SIZE * SWEEP_SIZE / SecondsPerRun([&] { volatile bool same = x == x; (void)same; }) * 1e-9,
+        };
+        std::cout << std::setw(10) << threads;
+        for (size_t i = 0; i < 3; ++i) {
+            if (threads == 1) {
+                base[i] = rates[i];
+            }
+            std::ostringstream cell;
+            cell << std::fixed << std::setprecision(2) << rates[i] << " (" << rates[i] / base[i] << ")";
+            std::cout << std::setw(i + 1 < 3 ? 24 : 0) << cell.str();
+        }
+        std::cout << std::endl;
+    }
+    task::parallel::setThreadCount(1);
+}
+
+// The operators as they were before expression templates, each returning a full temporary
+Matrix EagerAdd(const Matrix& a, const Matrix& b) {
+    Matrix res = a;
+    return res += b;
+}
+
+Matrix EagerSub(const Matrix& a, const Matrix& b) {
+    Matrix res = a;
+    return res -= b;
+}
+
+Matrix EagerScale(const Matrix& a, double factor) {
+    Matrix res = a;
+    return res *= factor;
+}
+
+void BenchExpressions() {
+    const size_t SIZE = 1024;
+
+    Matrix a = RandomMatrix(SIZE, SIZE);
+    Matrix b = RandomMatrix(SIZE, SIZE);
+    Matrix c = RandomMatrix(SIZE, SIZE);
+    Matrix d = RandomMatrix(SIZE, SIZE);
+    Matrix e = RandomMatrix(SIZE, SIZE);
+    Matrix res(SIZE, SIZE);
+
+    struct Expression {
+        std::string text;
+        std::function<void()> eager;
+        std::function<void()> fused;
+    };
+    Expression expressions[] = {
+        {"a + b - c",
+         [&] { res = EagerSub(EagerAdd(a, b), c); },
+         [&] { res = a + b - c; }},
+        {"a + b * 2 - c",
+         [&] { res = EagerSub(EagerAdd(a, EagerScale(b, 2.)), c); },
+         [&] { res = a + b * 2. - c; }},
+        {"2 * a - b + c * 0.5 - d",
+         [&] { res = EagerSub(EagerAdd(EagerSub(EagerScale(a, 2.), b), EagerScale(c, .5)), d); },
+         [&] { res = 2. * a - b + c * .5 - d; }},
+        {"(a - b) * 3 + c - d * 0.25 + e",
+         [&] { res = EagerAdd(EagerSub(EagerAdd(EagerScale(EagerSub(a, b), 3.), c), EagerScale(d, .25)), e); },
+         [&] { res = (a - b) * 3. + c - d * .25 + e; }},
+    };
+
+    std::cout << "\nExpressions on " << SIZE << "x" << SIZE << ", allocations and ms per evaluation\n";
+    std::cout << std::left << std::setw(34) << "expression" << std::setw(14) << "eager allocs" << std::setw(12) << "eager ms"
+              << std::setw(14) << "fused allocs" << "fused ms\n";
+    for (const Expression& expression : expressions) {
+        std::cout << std::setw(34) << expression.text;
+        for (const auto& run : {expression.eager, expression.fused}) {
+            size_t before = allocations.load();
+            run();
+            size_t count = allocations.load() - before;
+            std::cout << std::setw(14) << count << std::setw(12) << std::setprecision(3) << SecondsPerRun(run) * 1e3;
+        }
+        std::cout << std::endl;
+    }
+}
+
+void BenchLu() {
+    std::cout << "\nLU, ms\n";
+    std::cout << std::left << std::setw(8) << "size" << std::setw(12) << "det" << std::setw(12) << "inverse" << "solve (reused)\n";
+    for (size_t n : {250, 500, 1000, 2000}) {
+        Matrix a = RandomMatrix(n, n);
+        Matrix b = RandomMatrix(n, 1);
+        task::LUDecomposition lu(a);
+        std::cout << std::setw(8) << n << std::setprecision(3)
+                  << std::setw(12) << SecondsPerRun([&] { volatile double det = a.det(); (void)det; }) * 1e3
+                  << std::setw(12) << SecondsPerRun([&] { Matrix inverse = a.inverse(); }) * 1e3
+                  << SecondsPerRun([&] { Matrix x = lu.solve(b); }) * 1e3 << std::endl;
+    }
+}
+
+// The column-strided loop transposed() used to be
+void NaiveTranspose(const Matrix& a, Matrix& res) {
+    for (size_t i = 0; i < a.rowsCount; ++i) {
+        for (size_t j = 0; j < a.columnsCount; ++j) {
+            res[j][i] = a[i][j];
+        }
+    }
+}
+
+void BenchTranspose() {
+    std::cout << "\nTranspose, GB/s read + written\n";
+    std::cout << std::left << std::setw(8) << "size" << std::setw(10) << "naive" << std::setw(10) << "tiled"
+              << std::setw(12) << "in-place" << "in-place n x n/2\n";
+    // From L2-resident up to well past the last level cache
+    for (size_t n : {256, 1024, 4096}) {
+        Matrix a = RandomMatrix(n, n);
+        Matrix res(n, n);
+        Matrix wide = RandomMatrix(n, n / 2);
+        double bytes = 2. * sizeof(double) * n * n;
+
+        std::cout << std::setw(8) << n << std::setprecision(3)
+                  << std::setw(10) << bytes / SecondsPerRun([&] { NaiveTranspose(a, res); }) * 1e-9
+                  << std::setw(10) << bytes / SecondsPerRun([&] { task::transpose(n, n, a.data(), a.getStride(), res.data(), res.getStride()); }) * 1e-9
+                  << std::setw(12) << bytes / SecondsPerRun([&] { a.transpose(); }) * 1e-9
+                  << bytes / 2 / SecondsPerRun([&] { wide.transpose(); }) * 1e-9 << std::endl;
+    }
+}
+
+template<size_t N>
+void BenchFixedSize() {
+    const size_t COUNT = 1024;
+    std::vector<Matrix> dynamic;
+    std::vector<task::FixedMatrix<double, N, N>> fixed;
+    for (size_t i = 0; i < COUNT; ++i) {
+        dynamic.push_back(RandomMatrix(N, N));
+        fixed.emplace_back(dynamic.back());
+    }
+    std::vector<Matrix> dynamic_res(COUNT);
+    std::vector<task::FixedMatrix<double, N, N>> fixed_res(COUNT);
+    double dets = 0;
+
+    // Nanoseconds per call of f(i), over all neighbouring pairs of matrices
+    auto perCall = [&](auto f) {
+        return SecondsPerRun([&] {
+            for (size_t i = 0; i + 1 < COUNT; ++i) {
+                f(i);
+            }
+        }) / (COUNT - 1) * 1e9;
+    };
+
+    std::cout << std::setw(8) << N << std::setprecision(3)
+              << std::setw(10) << perCall([&](size_t i) { fixed_res[i] = fixed[i] * fixed[i + 1]; })
+              << std::setw(10) << perCall([&](size_t i) { dynamic_res[i] = dynamic[i] * dynamic[i + 1]; })
+              << std::setw(10) << perCall([&](size_t i) { dets += fixed[i].det(); })
+              << std::setw(10) << perCall([&](size_t i) { dets += dynamic[i].det(); })
+              << std::setw(10) << perCall([&](size_t i) { fixed_res[i] = fixed[i].inverse(); })
+              << perCall([&](size_t i) { dynamic_res[i] = dynamic[i].inverse(); }) << std::endl;
+    volatile double sink = dets;
+    (void)sink;
+}
+
+void BenchFixed() {
+    std::cout << "\nFixed-size vs dynamic matrices, ns per operation\n";
+    std::cout << std::left << std::setw(8) << "size" << std::setw(20) << "product" << std::setw(20) << "det" << "inverse\n";
+    std::cout << std::setw(8) << "";
+    for (int op = 0; op < 3; ++op) {
+        std::cout << std::setw(10) << "fixed" << std::setw(10) << "dynamic";
+    }
+    std::cout << std::endl;
+    BenchFixedSize<2>();
+    BenchFixedSize<3>();
+    BenchFixedSize<4>();
+}
+
+void BenchSparse() {
+    const size_t SIZE = 2048;
+    const size_t DENSE_COLUMNS = 16;
+
+    std::cout << "\nSparse vs dense " << SIZE << "x" << SIZE << " A, B with " << DENSE_COLUMNS << " columns, ms\n";
+    std::cout << "(each pair of columns is sparse, dense)\n";
+    std::cout << std::left << std::setw(10) << "density" << std::setw(14) << "MiB" << std::setw(16) << "A * x"
+              << std::setw(16) << "A * B" << "A * A\n";
+    std::mt19937 rand(42);
+    for (double density : {.001, .01}) {
+        std::bernoulli_distribution nonzero(density);
+        Matrix dense(SIZE, SIZE);
+        for (size_t row = 0; row < SIZE; ++row) {
+            for (size_t col = 0; col < SIZE; ++col) {
+                dense[row][col] = nonzero(rand) ? 1. + row % 7 : 0.;
+            }
+        }
+        task::SparseMatrix sparse(dense);
+        Matrix x = RandomMatrix(SIZE, 1);
+        Matrix b = RandomMatrix(SIZE, DENSE_COLUMNS);
+        Matrix res;
+
+        std::ostringstream mib;
+        mib << std::setprecision(3) << (sparse.nonZerosCount() * (sizeof(double) + sizeof(size_t)) + (SIZE + 1) * sizeof(size_t)) / 1048576.
+            << " " << SIZE * SIZE * sizeof(double) / 1048576.;
+        std::cout << std::setw(10) << density << std::setprecision(3) << std::setw(14) << mib.str()
+                  << std::setw(8) << SecondsPerRun([&] { res = sparse * x; }) * 1e3
+                  << std::setw(8) << SecondsPerRun([&] { res = dense * x; }) * 1e3
+                  << std::setw(8) << SecondsPerRun([&] { res = sparse * b; }) * 1e3
+                  << std::setw(8) << SecondsPerRun([&] { res = dense * b; }) * 1e3
+                  << std::setw(8) << SecondsPerRun([&] { task::SparseMatrix square = sparse * sparse; }) * 1e3
+                  << SecondsPerRun([&] { res = dense * dense; }) * 1e3 << std::endl;
+    }
+}
+
+void BenchSerialization() {
+    const size_t SIZE = 2048;
+    const std::string PATH = "/tmp/matrix_bench.bin";
+
+    Matrix a = RandomMatrix(SIZE, SIZE);
+    double mib = SIZE * SIZE * sizeof(double) / 1048576.;
+
+    // The text path writes six significant digits, so it is not even lossless
+    double text_write = SecondsPerRun([&] { std::ofstream(PATH) << SIZE << ' ' << SIZE << '\n' << a; });
+    double text_read = SecondsPerRun([&] { std::ifstream input(PATH); input >> a; });
+    double binary_write = SecondsPerRun([&] { task::saveBinary(PATH, a); });
+    double binary_read = SecondsPerRun([&] { a = task::loadBinary(PATH); });
+    // Mapping alone touches no element, summing them reads every page
+    double sum = 0;
+    double mapped_read = SecondsPerRun([&] {
+        task::MappedMatrix mapped(PATH);
+        for (size_t i = 0; i < SIZE * SIZE; ++i) {
+            sum += mapped.data()[i];
+        }
+    });
+    volatile double sink = sum;
+    (void)sink;
+    std::remove(PATH.c_str());
+
+    std::cout << "\nSerialization of " << SIZE << "x" << SIZE << ", MiB/s from and to the page cache\n";
+    std::cout << std::left << std::setw(12) << "" << std::setw(12) << "write" << "read\n" << std::setprecision(4)
+              << std::setw(12) << "text" << std::setw(12) << mib / text_write << mib / text_read << '\n'
+              << std::setw(12) << "binary" << std::setw(12) << mib / binary_write << mib / binary_read << '\n'
+              << std::setw(12) << "mmap" << std::setw(12) << "-" << mib / mapped_read << std::endl;
+}
+
+void BenchViews() {
+    std::cout << "\nA^T B, GFLOP/s with a copied and a viewed transpose\n";
+    std::cout << std::left << std::setw(8) << "size" << std::setw(10) << "copy" << "view\n";
+    for (size_t n : {64, 256, 1024}) {
+        Matrix a = RandomMatrix(n, n);
+        Matrix b = RandomMatrix(n, n);
+        double flops = 2. * n * n * n;
+
+        std::cout << std::setw(8) << n << std::setprecision(3)
+                  << std::setw(10) << flops / SecondsPerRun([&] { Matrix res = a.transposed() * b; }) * 1e-9
+                  << flops / SecondsPerRun([&] { Matrix res = a.transposedView() * b; }) * 1e-9 << std::endl;
+    }
+}
+
+
+int main() {
+    BenchGemm();
+    BenchSimd();
+    BenchScaling();
+    BenchExpressions();
+    BenchLu();
+    BenchTranspose();
+    BenchFixed();
+    BenchSparse();
+    BenchSerialization();
+    BenchViews();
+    return 0;
+}
@@ -4,10 +4,31 @@ set -e
 
 STRESS_TEST_COUNT=500
 
-g++ -std=c++17 -I./ test/test.cpp src/matrix.cpp -o matrix_test
+g++ -std=c++17 -pthread -I./ test/test.cpp src/*.cpp -o matrix_test
+g++ -std=c++17 -pthread -I./ test/gemm_test.cpp src/*.cpp -o gemm_test
+g++ -std=c++17 -pthread -I./ test/simd_test.cpp src/*.cpp -o simd_test
+g++ -std=c++17 -pthread -I./ test/parallel_test.cpp src/*.cpp -o parallel_test
+g++ -std=c++17 -pthread -I./ test/transpose_test.cpp src/*.cpp -o transpose_test
+g++ -std=c++17 -pthread -I./ test/lu_test.cpp src/*.cpp -o lu_test
+g++ -std=c++17 -pthread -I./ test/alloc_test.cpp src/*.cpp -o alloc_test
+g++ -std=c++17 -pthread -I./ test/fixed_test.cpp src/*.cpp -o fixed_test
+g++ -std=c++17 -pthread -I./ test/sparse_test.cpp src/*.cpp -o sparse_test
+g++ -std=c++17 -pthread -I./ test/serialization_test.cpp src/*.cpp -o serialization_test
+g++ -std=c++17 -pthread -I./ test/view_test.cpp src/*.cpp -o view_test
 python3 test/generate.py $STRESS_TEST_COUNT > test_data
 ./matrix_test $STRESS_TEST_COUNT < test_data
+./gemm_test
+./simd_test
+./parallel_test
+./transpose_test
+./lu_test
+./alloc_test
+./fixed_test
+./sparse_test
+./serialization_test
+./view_test
 
 rm test_data
+rm matrix_test gemm_test simd_test parallel_test transpose_test lu_test alloc_test fixed_test sparse_test serialization_test view_test
 
 echo All tests passed!
@@ -0,0 +1,517 @@
+#pragma once
+
+#include <cmath>
+#include <cstddef>
+#include <iostream>
+#include <type_traits>
+#include "matrix.h"
+
+
+namespace task {
+
+	// Rows x Cols matrix stored in place, for the small sizes where a heap
+	// buffer and runtime size checks cost more than the arithmetic. Sizes are
+	// part of the type, so mismatched operands do not compile. It is a
+	// MatrixExpression, so it mixes with Matrix in element-wise expressions,
+	// and converts to and from Matrix.
+	// Loops all have constant trip counts and unroll at -O2 and above
+	template<class T, size_t Rows, size_t Cols>
+	class FixedMatrix : public MatrixExpression<FixedMatrix<T, Rows, Cols>> {
+
+		static_assert(Rows > 0 && Cols > 0, "FixedMatrix needs at least one element");
+
+	public:
+
+		using value_type = T;
+		static constexpr size_t rowsCount = Rows;
+		static constexpr size_t columnsCount = Cols;
+
+		// All zeros
+		constexpr FixedMatrix() : values{} {}
+
+		// Elements row by row, exactly Rows * Cols of them
+		template<class... Values, class = std::enable_if_t<sizeof...(Values) == Rows * Cols && (Rows * Cols > 1)>>
+		constexpr FixedMatrix(Values... elements) : values{}
+		{
+			const T list[] = { static_cast<T>(elements)... };
+			for (size_t i = 0; i < Rows; ++i)
+			{
+				for (size_t j = 0; j < Cols; ++j)
+				{
+					values[i][j] = list[i * Cols + j];
+				}
+			}
+		}
+
+		// Throws SizeMismatchException unless a is Rows x Cols
+		explicit FixedMatrix(const Matrix& a) : values{}
+		{
+			if (a.rowsCount != Rows || a.columnsCount != Cols)
+			{
+				throw SizeMismatchException();
+			}
+			for (size_t i = 0; i < Rows; ++i)
+			{
+				for (size_t j = 0; j < Cols; ++j)
+				{
+					values[i][j] = static_cast<T>(a.valueAt(i, j));
+				}
+			}
+		}
+
+		static constexpr FixedMatrix identity()
+		{
+			FixedMatrix res;
+			for (size_t i = 0; i < (Rows < Cols ? Rows : Cols); ++i)
+			{
+				res.values[i][i] = 1;
+			}
+			return res;
+		}
+
+		// Unchecked, sizes known at compile time make bounds checks the caller's job
+		constexpr T* operator[](size_t row)
+		{
+			return values[row];
+		}
+
+		constexpr const T* operator[](size_t row) const
+		{
+			return values[row];
+		}
+
+		// Checked at compile time
+		template<size_t Row, size_t Col>
+		constexpr T& get()
+		{
+			static_assert(Row < Rows && Col < Cols, "FixedMatrix element out of bounds");
+			return values[Row][Col];
+		}
+
+		template<size_t Row, size_t Col>
+		constexpr const T& get() const
+		{
+			static_assert(Row < Rows && Col < Cols, "FixedMatrix element out of bounds");
+			return values[Row][Col];
+		}
+
+		double valueAt(size_t row, size_t col) const
+		{
+			return values[row][col];
+		}
+
+		// Views are taken of Matrix storage, never of a fixed matrix
+		constexpr bool aliases(const ConstMatrixView&) const
+		{
+			return false;
+		}
+
+		constexpr T* data()
+		{
+			return values[0];
+		}
+
+		constexpr const T* data() const
+		{
+			return values[0];
+		}
+
+		constexpr FixedMatrix& operator+=(const FixedMatrix& a)
+		{
+			for (size_t i = 0; i < Rows; ++i)
+			{
+				for (size_t j = 0; j < Cols; ++j)
+				{
+					values[i][j] += a.values[i][j];
+				}
+			}
+			return *this;
+		}
+
+		constexpr FixedMatrix& operator-=(const FixedMatrix& a)
+		{
+			for (size_t i = 0; i < Rows; ++i)
+			{
+				for (size_t j = 0; j < Cols; ++j)
+				{
+					values[i][j] -= a.values[i][j];
+				}
+			}
+			return *this;
+		}
+
+		constexpr FixedMatrix& operator*=(const T& number)
+		{
+			for (size_t i = 0; i < Rows; ++i)
+			{
+				for (size_t j = 0; j < Cols; ++j)
+				{
+					values[i][j] *= number;
+				}
+			}
+			return *this;
+		}
+
+		constexpr FixedMatrix& operator*=(const FixedMatrix<T, Cols, Cols>& a)
+		{
+			return *this = *this * a;
+		}
+
+		constexpr FixedMatrix<T, Cols, Rows> transposed() const
+		{
+			FixedMatrix<T, Cols, Rows> res;
+			for (size_t i = 0; i < Rows; ++i)
+			{
+				for (size_t j = 0; j < Cols; ++j)
+				{
+					res[j][i] = values[i][j];
+				}
+			}
+			return res;
+		}
+
+		constexpr T trace() const
+		{
+			static_assert(Rows == Cols, "trace() of a non-square matrix");
+			T res = 0;
+			for (size_t i = 0; i < Rows; ++i)
+			{
+				res += values[i][i];
+			}
+			return res;
+		}
+
+		// Closed forms up to 4 x 4, Gaussian elimination with partial pivoting above
+		constexpr T det() const
+		{
+			static_assert(Rows == Cols, "det() of a non-square matrix");
+			const auto& a = values;
+			if constexpr (Rows == 1)
+			{
+				return a[0][0];
+			}
+			else if constexpr (Rows == 2)
+			{
+				return a[0][0] * a[1][1] - a[0][1] * a[1][0];
+			}
+			else if constexpr (Rows == 3)
+			{
+				return a[0][0] * (a[1][1] * a[2][2] - a[1][2] * a[2][1])
+					- a[0][1] * (a[1][0] * a[2][2] - a[1][2] * a[2][0])
+					+ a[0][2] * (a[1][0] * a[2][1] - a[1][1] * a[2][0]);
+			}
+			else if constexpr (Rows == 4)
+			{
+				Minors4 m(a);
+				return m.det();
+			}
+			else
+			{
+				FixedMatrix lu = *this;
+				T res = 1;
+				for (size_t k = 0; k < Rows; ++k)
+				{
+					size_t pivot = lu.pivotRow(k);
+					if (lu.values[pivot][k] == 0)
+					{
+						return 0;
+					}
+					if (pivot != k)
+					{
+						lu.swapRows(pivot, k);
+						res = -res;
+					}
+					res *= lu.values[k][k];
+					for (size_t i = k + 1; i < Rows; ++i)
+					{
+						T factor = lu.values[i][k] / lu.values[k][k];
+						for (size_t j = k + 1; j < Cols; ++j)
+						{
+							lu.values[i][j] -= factor * lu.values[k][j];
+						}
+					}
+				}
+				return res;
+			}
+		}
+
+		// Adjugate over determinant up to 4 x 4, Gauss-Jordan elimination with
+		// partial pivoting above. Throws SingularMatrixException
+		constexpr FixedMatrix inverse() const
+		{
+			static_assert(Rows == Cols, "inverse() of a non-square matrix");
+			const auto& a = values;
+			FixedMatrix res;
+			if constexpr (Rows == 1)
+			{
+				if (a[0][0] == 0)
+				{
+					throw SingularMatrixException();
+				}
+				res.values[0][0] = 1 / a[0][0];
+			}
+			else if constexpr (Rows == 2)
+			{
+				T det = this->det();
+				if (det == 0)
+				{
+					throw SingularMatrixException();
+				}
+				res = FixedMatrix(a[1][1], -a[0][1], -a[1][0], a[0][0]);
+				res *= 1 / det;
+			}
+			else if constexpr (Rows == 3)
+			{
+				T det = this->det();
+				if (det == 0)
+				{
+					throw SingularMatrixException();
+				}
+				for (size_t i = 0; i < 3; ++i)
+				{
+					for (size_t j = 0; j < 3; ++j)
+					{
+						// Cofactor of a[j][i], the cyclic indices carry its sign
+						size_t r1 = (j + 1) % 3, r2 = (j + 2) % 3;
+						size_t c1 = (i + 1) % 3, c2 = (i + 2) % 3;
+						res.values[i][j] = (a[r1][c1] * a[r2][c2] - a[r1][c2] * a[r2][c1]) / det;
+					}
+				}
+			}
+			else if constexpr (Rows == 4)
+			{
+				Minors4 m(a);
+				T det = m.det();
+				if (det == 0)
+				{
+					throw SingularMatrixException();
+				}
+				T b[4][4] = {
+					{ a[1][1] * m.c5 - a[1][2] * m.c4 + a[1][3] * m.c3, -a[0][1] * m.c5 + a[0][2] * m.c4 - a[0][3] * m.c3,
+					  a[3][1] * m.s5 - a[3][2] * m.s4 + a[3][3] * m.s3, -a[2][1] * m.s5 + a[2][2] * m.s4 - a[2][3] * m.s3 },
+					{ -a[1][0] * m.c5 + a[1][2] * m.c2 - a[1][3] * m.c1, a[0][0] * m.c5 - a[0][2] * m.c2 + a[0][3] * m.c1,
+					  -a[3][0] * m.s5 + a[3][2] * m.s2 - a[3][3] * m.s1, a[2][0] * m.s5 - a[2][2] * m.s2 + a[2][3] * m.s1 },
+					{ a[1][0] * m.c4 - a[1][1] * m.c2 + a[1][3] * m.c0, -a[0][0] * m.c4 + a[0][1] * m.c2 - a[0][3] * m.c0,
+					  a[3][0] * m.s4 - a[3][1] * m.s2 + a[3][3] * m.s0, -a[2][0] * m.s4 + a[2][1] * m.s2 - a[2][3] * m.s0 },
+					{ -a[1][0] * m.c3 + a[1][1] * m.c1 - a[1][2] * m.c0, a[0][0] * m.c3 - a[0][1] * m.c1 + a[0][2] * m.c0,
+					  -a[3][0] * m.s3 + a[3][1] * m.s1 - a[3][2] * m.s0, a[2][0] * m.s3 - a[2][1] * m.s1 + a[2][2] * m.s0 },
+				};
+				for (size_t i = 0; i < 4; ++i)
+				{
+					for (size_t j = 0; j < 4; ++j)
+					{
+						res.values[i][j] = b[i][j] / det;
+					}
+				}
+			}
+			else
+			{
+				FixedMatrix lu = *this;
+				res = identity();
+				for (size_t k = 0; k < Rows; ++k)
+				{
+					size_t pivot = lu.pivotRow(k);
+					if (lu.values[pivot][k] == 0)
+					{
+						throw SingularMatrixException();
+					}
+					lu.swapRows(pivot, k);
+					res.swapRows(pivot, k);
+					for (size_t i = 0; i < Rows; ++i)
+					{
+						if (i == k)
+						{
+							continue;
+						}
+						T factor = lu.values[i][k] / lu.values[k][k];
+						for (size_t j = 0; j < Cols; ++j)
+						{
+							lu.values[i][j] -= factor * lu.values[k][j];
+							res.values[i][j] -= factor * res.values[k][j];
+						}
+					}
+				}
+				for (size_t i = 0; i < Rows; ++i)
+				{
+					T diagonal = lu.values[i][i];
+					for (size_t j = 0; j < Cols; ++j)
+					{
+						res.values[i][j] /= diagonal;
+					}
+				}
+			}
+			return res;
+		}
+
+	private:
+		T values[Rows][Cols];
+
+		template<class, size_t, size_t>
+		friend class FixedMatrix;
+
+		// 2 x 2 minors of the top two rows (s) and the bottom two rows (c),
+		// which the 4 x 4 determinant and adjugate are built from
+		struct Minors4 {
+			T s0, s1, s2, s3, s4, s5;
+			T c0, c1, c2, c3, c4, c5;
+
+			constexpr Minors4(const T (&a)[Rows][Cols])
+				: s0(a[0][0] * a[1][1] - a[1][0] * a[0][1]), s1(a[0][0] * a[1][2] - a[1][0] * a[0][2]),
+				  s2(a[0][0] * a[1][3] - a[1][0] * a[0][3]), s3(a[0][1] * a[1][2] - a[1][1] * a[0][2]),
+				  s4(a[0][1] * a[1][3] - a[1][1] * a[0][3]), s5(a[0][2] * a[1][3] - a[1][2] * a[0][3]),
+				  c0(a[2][0] * a[3][1] - a[3][0] * a[2][1]), c1(a[2][0] * a[3][2] - a[3][0] * a[2][2]),
+				  c2(a[2][0] * a[3][3] - a[3][0] * a[2][3]), c3(a[2][1] * a[3][2] - a[3][1] * a[2][2]),
+				  c4(a[2][1] * a[3][3] - a[3][1] * a[2][3]), c5(a[2][2] * a[3][3] - a[3][2] * a[2][3]) {}
+
+			constexpr T det() const
+			{
+				return s0 * c5 - s1 * c4 + s2 * c3 + s3 * c2 - s4 * c1 + s5 * c0;
+			}
+		};
+
+		// Row at or below k with the largest element in column k
+		constexpr size_t pivotRow(size_t k) const
+		{
+			size_t pivot = k;
+			for (size_t i = k + 1; i < Rows; ++i)
+			{
+				if (std::abs(values[i][k]) > std::abs(values[pivot][k]))
+				{
+					pivot = i;
+				}
+			}
+			return pivot;
+		}
+
+		constexpr void swapRows(size_t first, size_t second)
+		{
+			for (size_t j = 0; j < Cols; ++j)
+			{
+				T temp = values[first][j];
+				values[first][j] = values[second][j];
+				values[second][j] = temp;
+			}
+		}
+	};
+
+
+	using Matrix2 = FixedMatrix<double, 2, 2>;
+	using Matrix3 = FixedMatrix<double, 3, 3>;
+	using Matrix4 = FixedMatrix<double, 4, 4>;
+
+
+	template<class T, size_t Rows, size_t Cols>
+	struct Operand<FixedMatrix<T, Rows, Cols>> {
+		using type = const FixedMatrix<T, Rows, Cols>&;
+	};
+
+
+	template<class T, size_t Rows, size_t Cols>
+	constexpr FixedMatrix<T, Rows, Cols> operator+(FixedMatrix<T, Rows, Cols> left, const FixedMatrix<T, Rows, Cols>& right)
+	{
+		return left += right;
+	}
+
+	template<class T, size_t Rows, size_t Cols>
+	constexpr FixedMatrix<T, Rows, Cols> operator-(FixedMatrix<T, Rows, Cols> left, const FixedMatrix<T, Rows, Cols>& right)
+	{
+		return left -= right;
+	}
+
+	template<class T, size_t Rows, size_t Cols>
+	constexpr FixedMatrix<T, Rows, Cols> operator-(FixedMatrix<T, Rows, Cols> a)
+	{
+		return a *= -1;
+	}
+
+	// The factor does not take part in deduction, so 2 * a works for a double matrix
+	template<class T, size_t Rows, size_t Cols>
+	constexpr FixedMatrix<T, Rows, Cols> operator*(FixedMatrix<T, Rows, Cols> a, const typename FixedMatrix<T, Rows, Cols>::value_type& number)
+	{
+		return a *= number;
+	}
+
+	template<class T, size_t Rows, size_t Cols>
+	constexpr FixedMatrix<T, Rows, Cols> operator*(const typename FixedMatrix<T, Rows, Cols>::value_type& number, FixedMatrix<T, Rows, Cols> a)
+	{
+		return a *= number;
+	}
+
+	template<class T, size_t Rows, size_t Inner, size_t Cols>
+	constexpr FixedMatrix<T, Rows, Cols> operator*(const FixedMatrix<T, Rows, Inner>& left, const FixedMatrix<T, Inner, Cols>& right)
+	{
+		FixedMatrix<T, Rows, Cols> res;
+		for (size_t i = 0; i < Rows; ++i)
+		{
+			for (size_t j = 0; j < Cols; ++j)
+			{
+				T sum = 0;
+				for (size_t k = 0; k < Inner; ++k)
+				{
+					sum += left[i][k] * right[k][j];
+				}
+				res[i][j] = sum;
+			}
+		}
+		return res;
+	}
+
+	template<class T, size_t Rows, size_t Cols>
+	constexpr bool operator==(const FixedMatrix<T, Rows, Cols>& left, const FixedMatrix<T, Rows, Cols>& right)
+	{
+		for (size_t i = 0; i < Rows; ++i)
+		{
+			for (size_t j = 0; j < Cols; ++j)
+			{
+				if (std::abs(left[i][j] - right[i][j]) > EPS)
+				{
+					return false;
+				}
+			}
+		}
+		return true;
+	}
+
+	template<class T, size_t Rows, size_t Cols>
+	constexpr bool operator!=(const FixedMatrix<T, Rows, Cols>& left, const FixedMatrix<T, Rows, Cols>& right)
+	{
+		return !(left == right);
+	}
+
+	// Fixed matrices of different sizes would otherwise fall back to the
+	// MatrixExpression operators and only fail at run time
+	template<class T, size_t R1, size_t C1, size_t R2, size_t C2>
+	void operator+(const FixedMatrix<T, R1, C1>&, const FixedMatrix<T, R2, C2>&) = delete;
+
+	template<class T, size_t R1, size_t C1, size_t R2, size_t C2>
+	void operator-(const FixedMatrix<T, R1, C1>&, const FixedMatrix<T, R2, C2>&) = delete;
+
+	template<class T, size_t R1, size_t C1, size_t R2, size_t C2>
+	void operator*(const FixedMatrix<T, R1, C1>&, const FixedMatrix<T, R2, C2>&) = delete;
+
+	template<class T, size_t R1, size_t C1, size_t R2, size_t C2>
+	bool operator==(const FixedMatrix<T, R1, C1>&, const FixedMatrix<T, R2, C2>&) = delete;
+
+	template<class T, size_t R1, size_t C1, size_t R2, size_t C2>
+	bool operator!=(const FixedMatrix<T, R1, C1>&, const FixedMatrix<T, R2, C2>&) = delete;
+
+
+	template<class T, size_t Rows, size_t Cols>
+	std::ostream& operator<<(std::ostream& output, const FixedMatrix<T, Rows, Cols>& matrix)
+	{
+		for (size_t i = 0; i < Rows; ++i)
+		{
+			for (size_t j = 0; j < Cols; ++j)
+			{
+				if (j != 0)
+				{
+					output << ' ';
+				}
+				output << matrix[i][j];
+			}
+			output << '\n';
+		}
+		return output;
+	}
+
+}  // namespace task
@@ -0,0 +1,213 @@
+#include "gemm.h"
+#include "parallel.h"
+#include <algorithm>
+#include <memory>
+
+using namespace task;
+
+namespace
+{
+	// Register tile of C held in the micro-kernel accumulators
+	const size_t MR = 4;
+	const size_t NR = 8;
+
+	// Cache blocking: a KC x NR sliver of packed B stays in L1 while it is
+	// multiplied by every sliver of the MC x KC packed block of A sitting in L2,
+	// the KC x NC packed panel of B is reused from L3 by all blocks of A
+	const size_t KC = 256;
+	const size_t MC = 96;
+	const size_t NC = 2048;
+
+	// Below this many multiply-adds packing costs more than it saves
+	const size_t SMALL_PRODUCT = 32 * 32 * 32;
+
+	size_t roundUp(size_t value, size_t multiple)
+	{
+		return (value + multiple - 1) / multiple * multiple;
+	}
+
+	// Copies an mc x kc block of alpha * A as MR-row slivers, each stored column
+	// by column and padded with zeros, so the kernel reads it sequentially.
+	// Element (i, p) of A is a[i * rsa + p * csa]
+	void packA(size_t mc, size_t kc, const double* a, size_t rsa, size_t csa, double alpha, double* packed)
+	{
+		for (size_t i = 0; i < mc; i += MR)
+		{
+			size_t rows = std::min(MR, mc - i);
+			for (size_t p = 0; p < kc; ++p)
+			{
+				for (size_t r = 0; r < MR; ++r)
+				{
+					*packed++ = r < rows ? alpha * a[(i + r) * rsa + p * csa] : 0.0;
+				}
+			}
+		}
+	}
+
+	// Copies a kc x nc panel of B as NR-column slivers, each stored row by row
+	void packB(size_t kc, size_t nc, const double* b, size_t rsb, size_t csb, double* packed)
+	{
+		for (size_t j = 0; j < nc; j += NR)
+		{
+			size_t cols = std::min(NR, nc - j);
+			for (size_t p = 0; p < kc; ++p)
+			{
+				const double* row = b + p * rsb + j * csb;
+				for (size_t c = 0; c < NR; ++c)
+				{
+					*packed++ = c < cols ? row[c * csb] : 0.0;
+				}
+			}
+		}
+	}
+
+	// MR x NR tile of C += MR x kc sliver of A * kc x NR sliver of B,
+	// only the top-left rows x cols corner of the tile is written back
+	void kernel(size_t kc, const double* a, const double* b, double* c, size_t ldc, size_t rows, size_t cols)
+	{
+		double acc[MR][NR] = {};
+		for (size_t p = 0; p < kc; ++p)
+		{
+			for (size_t i = 0; i < MR; ++i)
+			{
+				for (size_t j = 0; j < NR; ++j)
+				{
+					acc[i][j] += a[i] * b[j];
+				}
+			}
+			a += MR;
+			b += NR;
+		}
+		for (size_t i = 0; i < rows; ++i)
+		{
+			for (size_t j = 0; j < cols; ++j)
+			{
+				c[i * ldc + j] += acc[i][j];
+			}
+		}
+	}
+
+	// Packing buffers of the calling thread, kept between calls
+	double* scratch(std::unique_ptr<double[]>& buffer, size_t& size, size_t needed)
+	{
+		if (size < needed)
+		{
+			buffer.reset(new double[needed]);
+			size = needed;
+		}
+		return buffer.get();
+	}
+
+	void blocked(size_t m, size_t n, size_t k, const double* a, size_t rsa, size_t csa,
+		const double* b, size_t rsb, size_t csb, double* c, size_t ldc, double alpha)
+	{
+		thread_local std::unique_ptr<double[]> packed_a_buffer;
+		thread_local std::unique_ptr<double[]> packed_b_buffer;
+		thread_local size_t packed_a_size = 0;
+		thread_local size_t packed_b_size = 0;
+
+		size_t max_kc = std::min(KC, k);
+		double* packed_a = scratch(packed_a_buffer, packed_a_size, roundUp(std::min(MC, m), MR) * max_kc);
+		double* packed_b = scratch(packed_b_buffer, packed_b_size, roundUp(std::min(NC, n), NR) * max_kc);
+
+		for (size_t jc = 0; jc < n; jc += NC)
+		{
+			size_t nc = std::min(NC, n - jc);
+			for (size_t pc = 0; pc < k; pc += KC)
+			{
+				size_t kc = std::min(KC, k - pc);
+				packB(kc, nc, b + pc * rsb + jc * csb, rsb, csb, packed_b);
+				for (size_t ic = 0; ic < m; ic += MC)
+				{
+					size_t mc = std::min(MC, m - ic);
+					packA(mc, kc, a + ic * rsa + pc * csa, rsa, csa, alpha, packed_a);
+					for (size_t jr = 0; jr < nc; jr += NR)
+					{
+						for (size_t ir = 0; ir < mc; ir += MR)
+						{
+							kernel(kc, packed_a + ir * kc, packed_b + jr * kc,
+								c + (ic + ir) * ldc + jc + jr, ldc,
+								std::min(MR, mc - ir), std::min(NR, nc - jr));
+						}
+					}
+				}
+			}
+		}
+	}
+
+	void naive(size_t m, size_t n, size_t k, const double* a, size_t rsa, size_t csa,
+		const double* b, size_t rsb, size_t csb, double* c, size_t ldc, double alpha)
+	{
+		for (size_t i = 0; i < m; ++i)
+		{
+			for (size_t p = 0; p < k; ++p)
+			{
+				double left = alpha * a[i * rsa + p * csa];
+				const double* right = b + p * rsb;
+				double* row = c + i * ldc;
+				// Unit stride kept apart so that the common case vectorizes
+				if (csb == 1)
+				{
+					for (size_t j = 0; j < n; ++j)
+					{
+						row[j] += left * right[j];
+					}
+				}
+				else
+				{
+					for (size_t j = 0; j < n; ++j)
+					{
+						row[j] += left * right[j * csb];
+					}
+				}
+			}
+		}
+	}
+}
+
+void task::gemm(size_t m, size_t n, size_t k,
+	const double* a, size_t lda,
+	const double* b, size_t ldb,
+	double* c, size_t ldc,
+	double alpha)
+{
+	gemm(m, n, k, a, lda, 1, b, ldb, 1, c, ldc, alpha);
+}
+
+void task::gemm(size_t m, size_t n, size_t k,
+	const double* a, size_t rsa, size_t csa,
+	const double* b, size_t rsb, size_t csb,
+	double* c, size_t ldc,
+	double alpha)
+{
+	if (m * n * k <= SMALL_PRODUCT)
+	{
+		naive(m, n, k, a, rsa, csa, b, rsb, csb, c, ldc, alpha);
+		return;
+	}
+	size_t threads = parallel::threadCount();
+	if (threads == 1)
+	{
+		blocked(m, n, k, a, rsa, csa, b, rsb, csb, c, ldc, alpha);
+		return;
+	}
+
+	// C is cut into tiles, each computed independently with its own packing.
+	// Aim for a few tiles per thread so uneven tiles still balance out
+	size_t tile_rows = std::min(MC, roundUp((m + 4 * threads - 1) / (4 * threads), MR));
+	size_t row_tiles = (m + tile_rows - 1) / tile_rows;
+	size_t col_tiles = std::max((n + NC - 1) / NC, (4 * threads + row_tiles - 1) / row_tiles);
+	size_t tile_cols = roundUp((n + col_tiles - 1) / col_tiles, NR);
+	col_tiles = (n + tile_cols - 1) / tile_cols;
+
+	parallel::forRange(row_tiles * col_tiles, 1, [&](size_t begin, size_t end)
+	{
+		for (size_t tile = begin; tile < end; ++tile)
+		{
+			size_t i = tile / col_tiles * tile_rows;
+			size_t j = tile % col_tiles * tile_cols;
+			blocked(std::min(tile_rows, m - i), std::min(tile_cols, n - j), k,
+				a + i * rsa, rsa, csa, b + j * csb, rsb, csb, c + i * ldc + j, ldc, alpha);
+		}
+	});
+}
@@ -0,0 +1,25 @@
+#pragma once
+
+#include <cstddef>
+
+
+namespace task {
+
+	// C += alpha * A * B, where A is m x k, B is k x n and C is m x n, all
+	// row-major with leading dimensions lda, ldb and ldc
+	void gemm(size_t m, size_t n, size_t k,
+		const double* a, size_t lda,
+		const double* b, size_t ldb,
+		double* c, size_t ldc,
+		double alpha = 1);
+
+	// The same with A and B of any row and column strides, element (i, p) of A
+	// is a[i * rsa + p * csa]. Packing reads them, so transposed or otherwise
+	// strided operands are multiplied without being copied first
+	void gemm(size_t m, size_t n, size_t k,
+		const double* a, size_t rsa, size_t csa,
+		const double* b, size_t rsb, size_t csb,
+		double* c, size_t ldc,
+		double alpha = 1);
+
+}  // namespace task
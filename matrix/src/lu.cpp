@@ -0,0 +1,192 @@
+#include "lu.h"
+#include "gemm.h"
+#include <algorithm>
+#include <cmath>
+#include <utility>
+
+using namespace task;
+
+namespace
+{
+	// Columns factored at a time, the rest of the matrix is updated once per
+	// panel by a matrix product instead of once per column
+	const size_t PANEL = 64;
+}
+
+LUDecomposition::LUDecomposition(const Matrix& a)
+	: lu(a), pivots(a.rowsCount)
+{
+	if (a.rowsCount != a.columnsCount)
+	{
+		throw SizeMismatchException();
+	}
+	size_t n = lu.rowsCount;
+	double* data = lu.data();
+	for (size_t k = 0; k < n; k += PANEL)
+	{
+		size_t end = std::min(k + PANEL, n);
+		factorPanel(k, end);
+
+		// U12 = L11^-1 A12, then A22 -= L21 U12
+		for (size_t j = k; j < end; ++j)
+		{
+			double* row = data + j * n;
+			for (size_t p = k; p < j; ++p)
+			{
+				double factor = row[p];
+				const double* upper = data + p * n;
+				for (size_t c = end; c < n; ++c)
+				{
+					row[c] -= factor * upper[c];
+				}
+			}
+		}
+		if (end < n)
+		{
+			gemm(n - end, n - end, end - k,
+				data + end * n + k, n,
+				data + k * n + end, n,
+				data + end * n + end, n,
+				-1);
+		}
+	}
+}
+
+// Unblocked elimination of columns [begin, end), only within those columns
+void LUDecomposition::factorPanel(size_t begin, size_t end)
+{
+	size_t n = lu.rowsCount;
+	double* data = lu.data();
+	for (size_t j = begin; j < end; ++j)
+	{
+		size_t pivot = j;
+		for (size_t i = j + 1; i < n; ++i)
+		{
+			if (std::abs(data[i * n + j]) > std::abs(data[pivot * n + j]))
+			{
+				pivot = i;
+			}
+		}
+		pivots[j] = pivot;
+		if (pivot != j)
+		{
+			std::swap_ranges(data + j * n, data + (j + 1) * n, data + pivot * n);
+			odd_swaps = !odd_swaps;
+		}
+
+		double diagonal = data[j * n + j];
+		if (diagonal == 0)
+		{
+			singular = true;
+			continue;
+		}
+		const double* row = data + j * n;
+		for (size_t i = j + 1; i < n; ++i)
+		{
+			double* lower = data + i * n;
+			double factor = lower[j] /= diagonal;
+			for (size_t c = j + 1; c < end; ++c)
+			{
+				lower[c] -= factor * row[c];
+			}
+		}
+	}
+}
+
+double LUDecomposition::det() const
+{
+	if (singular)
+	{
+		return 0;
+	}
+	double res = odd_swaps ? -1 : 1;
+	for (size_t i = 0; i < lu.rowsCount; ++i)
+	{
+		res *= lu.valueAt(i, i);
+	}
+	return res;
+}
+
+bool LUDecomposition::isSingular() const
+{
+	return singular;
+}
+
+Matrix LUDecomposition::solve(Matrix b) const
+{
+	size_t n = lu.rowsCount;
+	if (b.rowsCount != n)
+	{
+		throw SizeMismatchException();
+	}
+	if (singular)
+	{
+		throw SingularMatrixException();
+	}
+
+	Matrix x = std::move(b);
+	size_t k = x.columnsCount;
+	size_t ldx = x.getStride();
+	double* xs = x.data();
+	const double* a = lu.data();
+	for (size_t i = 0; i < n; ++i)
+	{
+		if (pivots[i] != i)
+		{
+			std::swap_ranges(xs + i * ldx, xs + i * ldx + k, xs + pivots[i] * ldx);
+		}
+	}
+
+	// Forward substitution with L: each block of rows first takes the product
+	// with all rows solved before it, then is finished row by row
+	for (size_t begin = 0; begin < n; begin += PANEL)
+	{
+		size_t end = std::min(begin + PANEL, n);
+		gemm(end - begin, k, begin, a + begin * n, n, xs, ldx, xs + begin * ldx, ldx, -1);
+		for (size_t i = begin; i < end; ++i)
+		{
+			double* row = xs + i * ldx;
+			for (size_t p = begin; p < i; ++p)
+			{
+				double factor = a[i * n + p];
+				const double* solved = xs + p * ldx;
+				for (size_t c = 0; c < k; ++c)
+				{
+					row[c] -= factor * solved[c];
+				}
+			}
+		}
+	}
+
+	// Back substitution with U, blocks from the bottom up
+	for (size_t end = n; end > 0;)
+	{
+		size_t begin = end > PANEL ? end - PANEL : 0;
+		gemm(end - begin, k, n - end, a + begin * n + end, n, xs + end * ldx, ldx, xs + begin * ldx, ldx, -1);
+		for (size_t i = end; i-- > begin;)
+		{
+			double* row = xs + i * ldx;
+			for (size_t p = i + 1; p < end; ++p)
+			{
+				double factor = a[i * n + p];
+				const double* solved = xs + p * ldx;
+				for (size_t c = 0; c < k; ++c)
+				{
+					row[c] -= factor * solved[c];
+				}
+			}
+			double diagonal = a[i * n + i];
+			for (size_t c = 0; c < k; ++c)
+			{
+				row[c] /= diagonal;
+			}
+		}
+		end = begin;
+	}
+	return x;
+}
+
+Matrix LUDecomposition::inverse() const
+{
+	return solve(Matrix(lu.rowsCount, lu.rowsCount));
+}
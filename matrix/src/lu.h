@@ -0,0 +1,36 @@
+#pragma once
+
+#include <vector>
+#include "matrix.h"
+
+
+namespace task {
+
+	// PA = LU factorization of a square matrix with partial pivoting.
+	// Factor once, then take the determinant, solve or invert as often as needed
+	class LUDecomposition {
+
+	public:
+
+		explicit LUDecomposition(const Matrix& a);
+
+		double det() const;
+		bool isSingular() const;
+
+		// X with AX = B, B has as many rows as A and any number of columns.
+		// X is computed in the storage of b, pass a temporary to skip a copy
+		Matrix solve(Matrix b) const;
+		Matrix inverse() const;
+
+	private:
+		// Unit lower triangle of L below the diagonal, U on and above it
+		Matrix lu;
+		// Row k was swapped with row pivots[k] at step k
+		std::vector<size_t> pivots;
+		bool odd_swaps = false;
+		bool singular = false;
+
+		void factorPanel(size_t begin, size_t end);
+	};
+
+}  // namespace task
@@ -1,77 +1,150 @@
 #include "matrix.h"
+#include "gemm.h"
+#include "lu.h"
+#include "parallel.h"
+#include "simd.h"
+#include "transpose.h"
 #include <algorithm>
+#include <atomic>
 #include <cmath>
+#include <utility>
+#include <vector>
 
 using namespace task;
 
+namespace
+{
+	// Calls f(dst offset, src offset, length) over runs of consecutive elements
+	// spread over the thread pool. Contiguous operands are one long run cut
+	// into blocks, strided ones are cut into blocks of whole rows
+	template<class F>
+	void forEachRun(size_t rows, size_t cols, size_t dst_stride, size_t src_stride, bool contiguous, F f)
+	{
+		if (contiguous)
+		{
+			parallel::forRange(rows * cols, parallel::SWEEP_GRAIN, [&](size_t begin, size_t end)
+			{
+				f(begin, begin, end - begin);
+			});
+			return;
+		}
+		parallel::forRange(rows, std::max<size_t>(1, parallel::SWEEP_GRAIN / std::max<size_t>(cols, 1)), [&](size_t begin, size_t end)
+		{
+			for (size_t i = begin; i < end; ++i)
+			{
+				f(i * dst_stride, i * src_stride, cols);
+			}
+		});
+	}
+}
+
 Matrix::Matrix()
 {
-	matrix = new double* [1];
-	matrix[0] = new double[1];
-	matrix[0][0] = 1;
-	rowsCount = 1;
-	columnsCount = 1;
+	allocate(1, 1);
+	buffer[0] = 1;
 }
 
 Matrix::Matrix(size_t rows, size_t cols)
 {
-	matrix = new double* [rows];
-	for (size_t i = 0; i < rows; ++i)
+	allocate(rows, cols);
+	std::fill(buffer, buffer + rows * cols, 0.0);
+	for (size_t i = 0; i < std::min(rows, cols); ++i)
 	{
-		matrix[i] = new double[cols];
-		for (size_t j = 0; j < cols; ++i)
-		{
-			if (i == j)
-			{
-				matrix[i][j] = 1;
-			}
-			else
-			{
-				matrix[i][j] = 0;
-			}
-		}
+		buffer[i * stride + i] = 1;
 	}
-	rowsCount = rows;
-	columnsCount = cols;
+}
+
+Matrix::Matrix(size_t rows, size_t cols, Uninitialized)
+{
+	allocate(rows, cols);
 }
 
 Matrix::Matrix(const Matrix& c)
 {
-	matrix = new double* [c.columnsCount];
-	for (size_t i = 0; i < c.rowsCount; ++i)
+	allocate(c.rowsCount, c.columnsCount);
+	for (size_t i = 0; i < rowsCount; ++i)
 	{
-		for (size_t j = 0; j < c.columnsCount; ++i)
-		{
-			matrix[i][j] = c.matrix[i][j];
-		}
+		std::copy(c.buffer + i * c.stride, c.buffer + i * c.stride + columnsCount, buffer + i * stride);
 	}
-	rowsCount = c.rowsCount;
-	columnsCount = c.columnsCount;
+}
+
+// The moved-from matrix is left empty, 0 x 0 without a buffer
+Matrix::Matrix(Matrix&& other) noexcept
+	: rowsCount(other.rowsCount), columnsCount(other.columnsCount),
+	  buffer(other.buffer), stride(other.stride), capacity(other.capacity)
+{
+	other.buffer = nullptr;
+	other.rowsCount = other.columnsCount = other.stride = other.capacity = 0;
 }
 
 Matrix& Matrix::operator=(const Matrix& a)
 {
+	if (this == &a)
+	{
+		return *this;
+	}
 	if (a.rowsCount != rowsCount || a.columnsCount != columnsCount)
 	{
-		throw SizeMismatchException();
+		reallocate(a.rowsCount, a.columnsCount);
 	}
 	for (size_t i = 0; i < rowsCount; ++i)
 	{
-		for (size_t j = 0; j < columnsCount; ++j)
-		{
-			matrix[i][j] = a.matrix[i][j];
-		}
+		std::copy(a.buffer + i * a.stride, a.buffer + i * a.stride + columnsCount, buffer + i * stride);
+	}
+	return *this;
+}
+
+Matrix& Matrix::operator=(Matrix&& a) noexcept
+{
+	if (this == &a)
+	{
+		return *this;
 	}
+	delete[] buffer;
+	buffer = a.buffer;
+	rowsCount = a.rowsCount;
+	columnsCount = a.columnsCount;
+	stride = a.stride;
+	capacity = a.capacity;
+	a.buffer = nullptr;
+	a.rowsCount = a.columnsCount = a.stride = a.capacity = 0;
 	return *this;
 }
 
+Matrix::~Matrix()
+{
+	delete[] buffer;
+}
+
+void Matrix::allocate(size_t rows, size_t cols)
+{
+	buffer = new double[rows * cols];
+	rowsCount = rows;
+	columnsCount = cols;
+	stride = cols;
+	capacity = rows * cols;
+}
+
+void Matrix::reallocate(size_t rows, size_t cols)
+{
+	if (rows * cols > capacity)
+	{
+		delete[] buffer;
+		allocate(rows, cols);
+		return;
+	}
+	rowsCount = rows;
+	columnsCount = cols;
+	stride = cols;
+}
+
 double& Matrix::get(size_t row, size_t col)
 {
 	if (row >= rowsCount || col >= columnsCount)
 	{
 		throw OutOfBoundsException();
 	}
-	return matrix[row][col];
+	return buffer[row * stride + col];
 }
 
 const double& Matrix::get(size_t row, size_t col) const
@@ -80,7 +153,7 @@ const double& Matrix::get(size_t row, size_t col) const
 	{
 		throw OutOfBoundsException();
 	}
-	return matrix[row][col];
+	return buffer[row * stride + col];
 }
 
 void Matrix::set(size_t row, size_t col, const double& value)
@@ -89,22 +162,41 @@ void Matrix::set(size_t row, size_t col, const double& value)
 	{
 		throw OutOfBoundsException();
 	}
-	matrix[row][col] = value;
+	buffer[row * stride + col] = value;
 }
 
 void Matrix::resize(size_t new_rows, size_t new_cols)
 {
-	double** new_matrix = new double* [new_cols];
+	// The rows still fit into the buffer at the old stride, only the new cells need zeroing
+	if (new_cols <= stride && new_rows * stride <= capacity)
+	{
+		for (size_t i = 0; i < new_rows; ++i)
+		{
+			size_t from = i < rowsCount ? std::min(columnsCount, new_cols) : 0;
+			std::fill(buffer + i * stride + from, buffer + i * stride + new_cols, 0.0);
+		}
+		rowsCount = new_rows;
+		columnsCount = new_cols;
+		return;
+	}
+
+	double* new_buffer = new double[new_rows * new_cols];
 	for (size_t i = 0; i < new_rows; ++i)
 	{
-		for (size_t j = 0; j < new_cols; ++i)
+		size_t from = 0;
+		if (i < rowsCount)
 		{
-			new_matrix[i][j] = matrix[i][j];
+			from = std::min(columnsCount, new_cols);
+			std::copy(buffer + i * stride, buffer + i * stride + from, new_buffer + i * new_cols);
 		}
+		std::fill(new_buffer + i * new_cols + from, new_buffer + (i + 1) * new_cols, 0.0);
 	}
-	matrix = new_matrix;
+	delete[] buffer;
+	buffer = new_buffer;
 	rowsCount = new_rows;
 	columnsCount = new_cols;
+	stride = new_cols;
+	capacity = new_rows * new_cols;
 }
 
 double* Matrix::operator[](size_t row)
@@ -113,7 +205,7 @@ double* Matrix::operator[](size_t row)
 	{
 		throw OutOfBoundsException();
 	}
-	return matrix[row];
+	return buffer + row * stride;
 }
 
 const double* Matrix::operator[](size_t row) const
@@ -122,178 +214,254 @@ const double* Matrix::operator[](size_t row) const
 	{
 		throw OutOfBoundsException();
 	}
-	return matrix[row];
+	return buffer + row * stride;
 }
 
 Matrix& Matrix::operator+=(const Matrix& a)
 {
 	if (rowsCount != a.rowsCount || columnsCount != a.columnsCount)
 	{
-		throw new SizeMismatchException;
+		throw SizeMismatchException();
 	}
-	for (size_t i = 0; i < rowsCount; ++i)
-	{
-		for (size_t j = 0; j < columnsCount; ++j)
+	double* dst = buffer;
+	const double* src = a.buffer;
+	forEachRun(rowsCount, columnsCount, stride, a.stride, isContiguous() && a.isContiguous(),
+		[=](size_t dst_offset, size_t src_offset, size_t length)
 		{
-			matrix[i][j] = a.matrix[i][j];
-		}
-	}
+			simd::add(dst + dst_offset, src + src_offset, length);
+		});
 	return *this;
 }
 
 Matrix& Matrix::operator-=(const Matrix& a)
 {
-	return *this += (-a);
+	if (rowsCount != a.rowsCount || columnsCount != a.columnsCount)
+	{
+		throw SizeMismatchException();
+	}
+	double* dst = buffer;
+	const double* src = a.buffer;
+	forEachRun(rowsCount, columnsCount, stride, a.stride, isContiguous() && a.isContiguous(),
+		[=](size_t dst_offset, size_t src_offset, size_t length)
+		{
+			simd::sub(dst + dst_offset, src + src_offset, length);
+		});
+	return *this;
 }
 
 Matrix& Matrix::operator*=(const Matrix& a)
 {
 	if (columnsCount != a.rowsCount)
 	{
-		throw new SizeMismatchException;
-	}
-	Matrix* res = new Matrix(rowsCount, a.columnsCount);
-	for (size_t i = 0; i < std::min(rowsCount, a.columnsCount); ++i)
-	{
-		res->matrix[i][i] = 0;
-	}
-	for (size_t i = 0; i < rowsCount; ++i)
-	{
-		for (size_t k = 0; k < columnsCount; ++k)
-		{
-			for (size_t j = 0; j < a.columnsCount; ++j)
-			{
-				res->matrix[i][j] += res->matrix[i][k] * a.matrix[k][j];
-			}
-		}
+		throw SizeMismatchException();
 	}
-	*this = *res;
-	return *this;
+	// gemm cannot write over its own operands, the product needs a buffer of its own
+	Matrix res(rowsCount, a.columnsCount, Uninitialized());
+	mulInto(a, res);
+	return *this = std::move(res);
 }
 
 Matrix& Matrix::operator*=(const double& number)
 {
-	for (size_t i = 0; i < rowsCount; ++i)
-	{
-		for (size_t j = 0; j < columnsCount; ++j)
+	double* dst = buffer;
+	double factor = number;
+	forEachRun(rowsCount, columnsCount, stride, stride, isContiguous(),
+		[=](size_t dst_offset, size_t, size_t length)
 		{
-			matrix[i][j] *= number;
-		}
-	}
+			simd::scale(dst + dst_offset, factor, length);
+		});
 	return *this;
 }
 
-Matrix Matrix::operator+(const Matrix& a) const
+Matrix Matrix::operator*(const Matrix& a) const
 {
-	if (rowsCount != a.rowsCount || columnsCount != a.columnsCount)
+	if (columnsCount != a.rowsCount)
 	{
-		throw new SizeMismatchException;
+		throw SizeMismatchException();
 	}
-	Matrix res = *this;
-	return res += a;
+	Matrix res(rowsCount, a.columnsCount, Uninitialized());
+	mulInto(a, res);
+	return res;
 }
 
-Matrix Matrix::operator-(const Matrix& a) const
+Matrix Matrix::operator+() const
 {
-	if (rowsCount != a.rowsCount || columnsCount != a.columnsCount)
+	return *this;
+}
+
+void Matrix::addInto(const Matrix& a, Matrix& dst) const
+{
+	dst = *this + a;
+}
+
+void Matrix::subInto(const Matrix& a, Matrix& dst) const
+{
+	dst = *this - a;
+}
+
+void Matrix::mulInto(const Matrix& a, Matrix& dst) const
+{
+	if (columnsCount != a.rowsCount)
+	{
+		throw SizeMismatchException();
+	}
+	if (&dst == this || &dst == &a)
+	{
+		dst = *this * a;
+		return;
+	}
+	dst.reallocate(rowsCount, a.columnsCount);
+	for (size_t i = 0; i < dst.rowsCount; ++i)
 	{
-		throw new SizeMismatchException;
+		std::fill(dst.buffer + i * dst.stride, dst.buffer + i * dst.stride + dst.columnsCount, 0.0);
 	}
-	Matrix res = *this;
-	return res -= a;
+	gemm(rowsCount, a.columnsCount, columnsCount, buffer, stride, a.buffer, a.stride, dst.buffer, dst.stride);
 }
 
-Matrix Matrix::operator*(const Matrix& a) const
+Matrix task::product(const ConstMatrixView& left, const ConstMatrixView& right)
 {
-	if (columnsCount != a.rowsCount)
+	if (left.columnsCount != right.rowsCount)
 	{
-		throw new SizeMismatchException;
+		throw SizeMismatchException();
 	}
-	Matrix res = *this;
-	return res *= a;
+	Matrix res(left.rowsCount, right.columnsCount, Matrix::Uninitialized());
+	std::fill(res.buffer, res.buffer + res.capacity, 0.0);
+	gemm(left.rowsCount, right.columnsCount, left.columnsCount,
+		left.data(), left.getRowStride(), left.getColumnStride(),
+		right.data(), right.getRowStride(), right.getColumnStride(),
+		res.buffer, res.stride);
+	return res;
 }
 
-Matrix Matrix::operator*(const double& a) const
+double Matrix::det() const
 {
-	Matrix res = *this;
-	return res *= a;
+	return LUDecomposition(*this).det();
 }
 
-Matrix Matrix::operator-() const
+Matrix Matrix::inverse() const
 {
-	return (*this) * -1.0;
+	return LUDecomposition(*this).inverse();
 }
 
-Matrix Matrix::operator+() const
+Matrix Matrix::solve(const Matrix& b) const
 {
-	return *this;
+	return LUDecomposition(*this).solve(b);
 }
 
-double Matrix::det() const
+void Matrix::transpose()
 {
-	if (rowsCount != columnsCount)
+	if (rowsCount == columnsCount)
 	{
-		throw new SizeMismatchException;
+		transposeSquare(rowsCount, buffer, stride);
+		return;
 	}
-	if (rowsCount == 0)
-		return matrix[0][0];
-	double res = 0;
-	Matrix* minor;
-	for (size_t i = 0; i < columnsCount; ++i)
+	if (isContiguous())
 	{
-		*minor = *this;
-		--minor->rowsCount;
-		--minor->columnsCount;
-		res += std::pow(-1, i + 1) * matrix[0][i] * det();
+		transposeInPlace(rowsCount, columnsCount, buffer);
+		std::swap(rowsCount, columnsCount);
+		stride = columnsCount;
+		return;
 	}
-	return res;
-}
-
-void Matrix::transpose()
-{
-	std::swap(columnsCount, rowsCount);
-	matrix = Matrix::transposed().matrix;
+	*this = transposed();
 }
 
 Matrix Matrix::transposed() const
 {
-	Matrix* res = new Matrix(columnsCount, rowsCount);
-	for (size_t i = 0; i < rowsCount; ++i)
-	{
-		for (size_t j = 0; j < columnsCount; ++j)
-		{
-			res->matrix[j][i] = matrix[i][j];
-		}
-	}
-	return *res;
+	Matrix res(columnsCount, rowsCount, Uninitialized());
+	task::transpose(rowsCount, columnsCount, buffer, stride, res.buffer, res.stride);
+	return res;
 }
 
 double Matrix::trace() const
 {
 	if (rowsCount != columnsCount)
-		throw new SizeMismatchException;
+		throw SizeMismatchException();
+
+	// Every diagonal element sits on its own cache line, so it is summed in
+	// blocks on the pool and the block sums are added up in order
+	const size_t GRAIN = 4096;
+	std::vector<double> sums((rowsCount + GRAIN - 1) / GRAIN);
+	parallel::forRange(rowsCount, GRAIN, [&](size_t begin, size_t end)
+	{
+		double sum = 0;
+		for (size_t i = begin; i < end; ++i)
+		{
+			sum += buffer[i * stride + i];
+		}
+		sums[begin / GRAIN] = sum;
+	});
 
 	double res = 0;
-	for (size_t i = 0; i < rowsCount; ++i)
+	for (double sum : sums)
 	{
-		res += matrix[i][i];
+		res += sum;
 	}
 	return res;
 }
 
 double* Matrix::getRow(size_t row)
 {
-	return matrix[row];
+	return buffer + row * stride;
 }
 
-double* Matrix::getColumn(size_t column)
+VectorView Matrix::getColumn(size_t column)
 {
-	double* res = new double[rowsCount];
-	for (size_t i = 0; i < rowsCount; ++i)
-	{
-		res[i] = matrix[i][column];
-	}
-	return res;
+	return VectorView(buffer + column, stride, rowsCount);
+}
+
+ConstVectorView Matrix::getColumn(size_t column) const
+{
+	return ConstVectorView(buffer + column, stride, rowsCount);
+}
+
+MatrixView Matrix::view()
+{
+	return MatrixView(buffer, rowsCount, columnsCount, stride, 1);
+}
+
+ConstMatrixView Matrix::view() const
+{
+	return ConstMatrixView(buffer, rowsCount, columnsCount, stride, 1);
+}
+
+MatrixView Matrix::block(size_t row, size_t col, size_t rows, size_t cols)
+{
+	return view().block(row, col, rows, cols);
+}
+
+ConstMatrixView Matrix::block(size_t row, size_t col, size_t rows, size_t cols) const
+{
+	return view().block(row, col, rows, cols);
+}
+
+MatrixView Matrix::row(size_t row)
+{
+	return view().row(row);
+}
+
+ConstMatrixView Matrix::row(size_t row) const
+{
+	return view().row(row);
+}
+
+MatrixView Matrix::column(size_t col)
+{
+	return view().column(col);
+}
+
+ConstMatrixView Matrix::column(size_t col) const
+{
+	return view().column(col);
+}
+
+MatrixView Matrix::transposedView()
+{
+	return view().transposed();
+}
+
+ConstMatrixView Matrix::transposedView() const
+{
+	return view().transposed();
 }
 
 bool Matrix::operator==(const Matrix& a) const
@@ -301,44 +469,73 @@ bool Matrix::operator==(const Matrix& a) const
 	if (rowsCount != a.rowsCount || columnsCount != a.columnsCount)
 		return false;
 
-	for (size_t i = 0; i < rowsCount; ++i)
-	{
-		for (size_t j = 0; j < columnsCount; ++j)
+	// Blocks after the first mismatch found are skipped
+	std::atomic<bool> different{ false };
+	const double* left = buffer;
+	const double* right = a.buffer;
+	forEachRun(rowsCount, columnsCount, stride, a.stride, isContiguous() && a.isContiguous(),
+		[&](size_t left_offset, size_t right_offset, size_t length)
 		{
-			if (std::abs(matrix[i][j] - a.matrix[i][j]) > EPS)
+			if (!different.load(std::memory_order_relaxed)
+				&& !simd::equal(left + left_offset, right + right_offset, length, EPS))
 			{
-				return false;
+				different.store(true, std::memory_order_relaxed);
 			}
-		}
-	}
-	return true;
+		});
+	return !different.load();
 }
 
 bool Matrix::operator!=(const Matrix& a) const
 {
-	return *this == a;
+	return !(*this == a);
 }
 
+double* Matrix::data()
+{
+	return buffer;
+}
 
-Matrix task::operator*(const double& a, const Matrix& b)
+const double* Matrix::data() const
 {
-	return b * a;
+	return buffer;
 }
 
+size_t Matrix::getStride() const
+{
+	return stride;
+}
+
+bool Matrix::isContiguous() const
+{
+	return stride == columnsCount || rowsCount <= 1;
+}
+
+
 std::ostream& task::operator<<(std::ostream& output, const Matrix& matrix)
 {
 	for (size_t i = 0; i < matrix.rowsCount; ++i)
 	{
 		for (size_t j = 0; j < matrix.columnsCount; ++j)
 		{
+			if (j != 0)
+			{
+				output << ' ';
+			}
 			output << matrix[i][j];
 		}
+		output << '\n';
 	}
 	return output;
 }
 
 std::istream& task::operator>>(std::istream& input, Matrix& matrix)
 {
+	size_t rows, cols;
+	if (!(input >> rows >> cols))
+	{
+		return input;
+	}
+	matrix.resize(rows, cols);
 	for (size_t i = 0; i < matrix.rowsCount; ++i)
 	{
 		for (size_t j = 0; j < matrix.columnsCount; ++j)
@@ -1,6 +1,10 @@
 #pragma once
 
+#include <algorithm>
+#include <cmath>
 #include <iostream>
+#include <type_traits>
+#include "parallel.h"
 
 
 namespace task {
@@ -10,16 +14,57 @@ namespace task {
 
 	class OutOfBoundsException : public std::exception {};
 	class SizeMismatchException : public std::exception {};
+	class SingularMatrixException : public std::exception {};
 
 
-	class Matrix {
+	// Base of everything that can appear in element-wise matrix arithmetic.
+	// E provides rowsCount, columnsCount and valueAt(row, col)
+	template<class E>
+	class MatrixExpression {
+
+	public:
+
+		const E& self() const
+		{
+			return static_cast<const E&>(*this);
+		}
+	};
+
+
+	// Non-owning strided views of matrix elements, defined below Matrix.
+	// T is double for views writing through, const double for read-only ones
+	template<class T>
+	class BasicMatrixView;
+	template<class T>
+	class BasicVectorView;
+
+	using MatrixView = BasicMatrixView<double>;
+	using ConstMatrixView = BasicMatrixView<const double>;
+	using VectorView = BasicVectorView<double>;
+	using ConstVectorView = BasicVectorView<const double>;
+
+
+	class Matrix : public MatrixExpression<Matrix> {
 
 	public:
 
 		Matrix();
 		Matrix(size_t rows, size_t cols);
+		// Storage for results that overwrite every element anyway, the
+		// elements are left undefined
+		struct Uninitialized {};
+		Matrix(size_t rows, size_t cols, Uninitialized);
 		Matrix(const Matrix& copy);
+		Matrix(Matrix&& other) noexcept;
 		Matrix& operator=(const Matrix& a);
+		Matrix& operator=(Matrix&& a) noexcept;
+		~Matrix();
+
+		// Evaluates a whole expression in one sweep, without temporaries
+		template<class E>
+		Matrix(const MatrixExpression<E>& e);
+		template<class E>
+		Matrix& operator=(const MatrixExpression<E>& e);
 
 		double& get(size_t row, size_t col);
 		const double& get(size_t row, size_t col) const;
@@ -34,33 +79,574 @@ namespace task {
 		Matrix& operator*=(const Matrix& a);
 		Matrix& operator*=(const double& number);
 
-		Matrix operator+(const Matrix& a) const;
-		Matrix operator-(const Matrix& a) const;
-		Matrix operator*(const Matrix& a) const;
-		Matrix operator*(const double& a) const;
+		template<class E>
+		Matrix& operator+=(const MatrixExpression<E>& e);
+		template<class E>
+		Matrix& operator-=(const MatrixExpression<E>& e);
 
-		Matrix operator-() const;
+		Matrix operator*(const Matrix& a) const;
 		Matrix operator+() const;
 
+		// dst = *this + a, *this - a or *this * a, reusing the buffer of dst
+		// when it is big enough. dst may be *this or a
+		void addInto(const Matrix& a, Matrix& dst) const;
+		void subInto(const Matrix& a, Matrix& dst) const;
+		void mulInto(const Matrix& a, Matrix& dst) const;
+
 		double det() const;
+		Matrix inverse() const;
+		Matrix solve(const Matrix& b) const;
 		void transpose();
 		Matrix transposed() const;
 		double trace() const;
 
 		double* getRow(size_t row);
-		double* getColumn(size_t column);
+		// Strided view of the column, nothing is copied
+		VectorView getColumn(size_t column);
+		ConstVectorView getColumn(size_t column) const;
+
+		// Views of the elements, valid until the matrix is resized, reassigned
+		// to another size, moved from or destroyed. Throw OutOfBoundsException
+		MatrixView view();
+		ConstMatrixView view() const;
+		MatrixView block(size_t row, size_t col, size_t rows, size_t cols);
+		ConstMatrixView block(size_t row, size_t col, size_t rows, size_t cols) const;
+		MatrixView row(size_t row);
+		ConstMatrixView row(size_t row) const;
+		MatrixView column(size_t col);
+		ConstMatrixView column(size_t col) const;
+		MatrixView transposedView();
+		ConstMatrixView transposedView() const;
 
 		bool operator==(const Matrix& a) const;
 		bool operator!=(const Matrix& a) const;
 
+		// Row-major storage: element (i, j) lives at data()[i * getStride() + j]
+		double* data();
+		const double* data() const;
+		size_t getStride() const;
+		bool isContiguous() const;
+
+		// Unchecked element read used by expression evaluation
+		double valueAt(size_t row, size_t col) const
+		{
+			return buffer[row * stride + col];
+		}
+
+		// Whether the expression reads an element of target other than the one
+		// at the position being evaluated. Every expression node has it, so
+		// writes can tell when they would overwrite their own input
+		bool aliases(const ConstMatrixView& target) const;
+
+		size_t rowsCount;
+		size_t columnsCount;
+	private:
+		// One buffer for all rows, stride >= columnsCount so that shrinking
+		// the columns keeps the rows where they are
+		double* buffer;
+		size_t stride;
+		size_t capacity;
+
+		void allocate(size_t rows, size_t cols);
+		// Gives the matrix new dimensions and undefined elements, allocating
+		// only if the buffer cannot hold them
+		void reallocate(size_t rows, size_t cols);
+
+		// Calls f(element, value of e at the element) for every element, on the thread pool
+		template<class E, class F>
+		void sweep(const E& e, F f);
+		// The same, through a copy of e when e aliases this matrix
+		template<class E, class F>
+		void update(const E& e, F f);
+
+		friend Matrix product(const ConstMatrixView& left, const ConstMatrixView& right);
+	};
+
+
+	// Elements origin[i * stride] for i < size(), behaves like the row
+	// pointer Matrix::operator[] returns but may step over a row stride
+	template<class T>
+	class BasicVectorView {
+
+	public:
+
+		BasicVectorView(T* origin, size_t stride, size_t size)
+			: origin(origin), stride(stride), count(size) {}
+
+		// Unchecked
+		T& operator[](size_t index) const
+		{
+			return origin[index * stride];
+		}
+
+		size_t size() const
+		{
+			return count;
+		}
+
+	private:
+		T* origin;
+		size_t stride;
+		size_t count;
+	};
+
+
+	// rows x cols elements origin[i * rowStride + j * colStride]. Taking
+	// blocks, rows, columns or the transpose only changes the origin and the
+	// strides. Copies are shallow, like pointers, and the view methods are
+	// const for the same reason: constness of the elements is in T
+	template<class T>
+	class BasicMatrixView : public MatrixExpression<BasicMatrixView<T>> {
+
+	public:
+
+		BasicMatrixView(T* origin, size_t rows, size_t cols, size_t rowStride, size_t colStride)
+			: rowsCount(rows), columnsCount(cols), origin(origin), rowStride(rowStride), colStride(colStride) {}
+
+		// A view writing through converts to a read-only one
+		template<class U, class = std::enable_if_t<std::is_same<const U, T>::value && !std::is_same<U, T>::value>>
+		BasicMatrixView(const BasicMatrixView<U>& other)
+			: BasicMatrixView(other.data(), other.rowsCount, other.columnsCount, other.getRowStride(), other.getColumnStride()) {}
+
+		// Throws OutOfBoundsException unless the block lies inside the view
+		BasicMatrixView block(size_t row, size_t col, size_t rows, size_t cols) const
+		{
+			if (row > rowsCount || rows > rowsCount - row || col > columnsCount || cols > columnsCount - col)
+			{
+				throw OutOfBoundsException();
+			}
+			return BasicMatrixView(origin + row * rowStride + col * colStride, rows, cols, rowStride, colStride);
+		}
+
+		BasicMatrixView row(size_t row) const
+		{
+			return block(row, 0, 1, columnsCount);
+		}
+
+		BasicMatrixView column(size_t col) const
+		{
+			return block(0, col, rowsCount, 1);
+		}
+
+		BasicMatrixView transposed() const
+		{
+			return BasicMatrixView(origin, columnsCount, rowsCount, colStride, rowStride);
+		}
+
+		BasicVectorView<T> operator[](size_t row) const
+		{
+			if (row >= rowsCount)
+			{
+				throw OutOfBoundsException();
+			}
+			return BasicVectorView<T>(origin + row * rowStride, colStride, columnsCount);
+		}
+
+		T& get(size_t row, size_t col) const
+		{
+			if (row >= rowsCount || col >= columnsCount)
+			{
+				throw OutOfBoundsException();
+			}
+			return origin[row * rowStride + col * colStride];
+		}
+
+		double valueAt(size_t row, size_t col) const
+		{
+			return origin[row * rowStride + col * colStride];
+		}
+
+		T* data() const
+		{
+			return origin;
+		}
+
+		// The same elements in the same places are safe, anything else is
+		// compared by the range of addresses it spans
+		bool aliases(const BasicMatrixView<const double>& target) const
+		{
+			if (origin == target.data() && rowStride == target.getRowStride() && colStride == target.getColumnStride()
+				&& rowsCount == target.rowsCount && columnsCount == target.columnsCount)
+			{
+				return false;
+			}
+			if (rowsCount == 0 || columnsCount == 0 || target.rowsCount == 0 || target.columnsCount == 0)
+			{
+				return false;
+			}
+			const double* last = origin + (rowsCount - 1) * rowStride + (columnsCount - 1) * colStride;
+			const double* targetLast = target.data() + (target.rowsCount - 1) * target.getRowStride()
+				+ (target.columnsCount - 1) * target.getColumnStride();
+			return origin <= targetLast && target.data() <= last;
+		}
+
+		size_t getRowStride() const
+		{
+			return rowStride;
+		}
+
+		size_t getColumnStride() const
+		{
+			return colStride;
+		}
+
+		// Write e into the viewed elements. If e reads the viewed elements
+		// anywhere but at the position being written, as in
+		// a.view().assign(a.transposedView()), it is evaluated into a temporary
+		// first. Throw SizeMismatchException
+		template<class E>
+		const BasicMatrixView& assign(const MatrixExpression<E>& e) const
+		{
+			update(e.self(), [](T& element, double value) { element = value; });
+			return *this;
+		}
+
+		template<class E>
+		const BasicMatrixView& operator+=(const MatrixExpression<E>& e) const
+		{
+			update(e.self(), [](T& element, double value) { element += value; });
+			return *this;
+		}
+
+		template<class E>
+		const BasicMatrixView& operator-=(const MatrixExpression<E>& e) const
+		{
+			update(e.self(), [](T& element, double value) { element -= value; });
+			return *this;
+		}
+
 		size_t rowsCount;
 		size_t columnsCount;
 	private:
-		double** matrix;
+		T* origin;
+		size_t rowStride;
+		size_t colStride;
+
+		template<class E, class F>
+		void update(const E& e, F f) const
+		{
+			static_assert(!std::is_const<T>::value, "Writing through a read-only view");
+			if (e.rowsCount != rowsCount || e.columnsCount != columnsCount)
+			{
+				throw SizeMismatchException();
+			}
+			if (e.aliases(*this))
+			{
+				sweep(Matrix(e), f);
+				return;
+			}
+			sweep(e, f);
+		}
+
+		template<class E, class F>
+		void sweep(const E& e, F f) const
+		{
+			size_t grain = std::max<size_t>(1, parallel::SWEEP_GRAIN / std::max<size_t>(columnsCount, 1));
+			parallel::forRange(rowsCount, grain, [&](size_t begin, size_t end)
+			{
+				for (size_t i = begin; i < end; ++i)
+				{
+					T* row = origin + i * rowStride;
+					for (size_t j = 0; j < columnsCount; ++j)
+					{
+						f(row[j * colStride], e.valueAt(i, j));
+					}
+				}
+			});
+		}
+	};
+
+
+	inline bool Matrix::aliases(const ConstMatrixView& target) const
+	{
+		return view().aliases(target);
+	}
+
+
+	// How an expression node holds an operand: matrices by reference, nodes by value.
+	// Expressions therefore must not outlive the matrices they were built from
+	template<class E>
+	struct Operand {
+		using type = E;
+	};
+
+	template<>
+	struct Operand<Matrix> {
+		using type = const Matrix&;
+	};
+
+
+	struct Plus {
+		static double apply(double left, double right)
+		{
+			return left + right;
+		}
+	};
+
+	struct Minus {
+		static double apply(double left, double right)
+		{
+			return left - right;
+		}
+	};
+
+
+	template<class L, class R, class Op>
+	class BinaryExpression : public MatrixExpression<BinaryExpression<L, R, Op>> {
+
+	public:
+
+		BinaryExpression(const L& left, const R& right)
+			: left(left), right(right), rowsCount(left.rowsCount), columnsCount(left.columnsCount)
+		{
+			if (left.rowsCount != right.rowsCount || left.columnsCount != right.columnsCount)
+			{
+				throw SizeMismatchException();
+			}
+		}
+
+		double valueAt(size_t row, size_t col) const
+		{
+			return Op::apply(left.valueAt(row, col), right.valueAt(row, col));
+		}
+
+		bool aliases(const ConstMatrixView& target) const
+		{
+			return left.aliases(target) || right.aliases(target);
+		}
+
+	private:
+		typename Operand<L>::type left;
+		typename Operand<R>::type right;
+	public:
+		const size_t rowsCount;
+		const size_t columnsCount;
+	};
+
+
+	template<class E>
+	class ScaledExpression : public MatrixExpression<ScaledExpression<E>> {
+
+	public:
+
+		ScaledExpression(const E& operand, double factor)
+			: operand(operand), factor(factor), rowsCount(operand.rowsCount), columnsCount(operand.columnsCount) {}
+
+		double valueAt(size_t row, size_t col) const
+		{
+			return operand.valueAt(row, col) * factor;
+		}
+
+		bool aliases(const ConstMatrixView& target) const
+		{
+			return operand.aliases(target);
+		}
+
+	private:
+		typename Operand<E>::type operand;
+		double factor;
+	public:
+		const size_t rowsCount;
+		const size_t columnsCount;
 	};
 
 
-	Matrix operator*(const double& a, const Matrix& b);
+	template<class L, class R>
+	BinaryExpression<L, R, Plus> operator+(const MatrixExpression<L>& left, const MatrixExpression<R>& right)
+	{
+		return BinaryExpression<L, R, Plus>(left.self(), right.self());
+	}
+
+	template<class L, class R>
+	BinaryExpression<L, R, Minus> operator-(const MatrixExpression<L>& left, const MatrixExpression<R>& right)
+	{
+		return BinaryExpression<L, R, Minus>(left.self(), right.self());
+	}
+
+	template<class E>
+	ScaledExpression<E> operator*(const MatrixExpression<E>& e, double a)
+	{
+		return ScaledExpression<E>(e.self(), a);
+	}
+
+	template<class E>
+	ScaledExpression<E> operator*(double a, const MatrixExpression<E>& e)
+	{
+		return ScaledExpression<E>(e.self(), a);
+	}
+
+	template<class E>
+	ScaledExpression<E> operator-(const MatrixExpression<E>& e)
+	{
+		return ScaledExpression<E>(e.self(), -1.0);
+	}
+
+	// Matrix products are not element-wise, their operands are evaluated first
+	template<class L, class R>
+	Matrix operator*(const MatrixExpression<L>& left, const MatrixExpression<R>& right)
+	{
+		return Matrix(left) * Matrix(right);
+	}
+
+	template<class L>
+	Matrix operator*(const MatrixExpression<L>& left, const Matrix& right)
+	{
+		return Matrix(left) * right;
+	}
+
+	template<class R>
+	Matrix operator*(const Matrix& left, const MatrixExpression<R>& right)
+	{
+		return left * Matrix(right);
+	}
+
+	// A * B of any strided operands, straight from their elements
+	Matrix product(const ConstMatrixView& left, const ConstMatrixView& right);
+
+	// Products of views skip evaluating the operands into matrices
+	template<class T, class U>
+	Matrix operator*(const BasicMatrixView<T>& left, const BasicMatrixView<U>& right)
+	{
+		return product(left, right);
+	}
+
+	template<class T>
+	Matrix operator*(const BasicMatrixView<T>& left, const Matrix& right)
+	{
+		return product(left, right.view());
+	}
+
+	template<class T>
+	Matrix operator*(const Matrix& left, const BasicMatrixView<T>& right)
+	{
+		return product(left.view(), right);
+	}
+
+	template<class L, class R>
+	bool equalElements(const L& left, const R& right)
+	{
+		if (left.rowsCount != right.rowsCount || left.columnsCount != right.columnsCount)
+			return false;
+
+		for (size_t i = 0; i < left.rowsCount; ++i)
+		{
+			for (size_t j = 0; j < left.columnsCount; ++j)
+			{
+				if (std::abs(left.valueAt(i, j) - right.valueAt(i, j)) > EPS)
+				{
+					return false;
+				}
+			}
+		}
+		return true;
+	}
+
+	template<class L, class R>
+	bool operator==(const MatrixExpression<L>& left, const MatrixExpression<R>& right)
+	{
+		return equalElements(left.self(), right.self());
+	}
+
+	template<class L, class R>
+	bool operator!=(const MatrixExpression<L>& left, const MatrixExpression<R>& right)
+	{
+		return !equalElements(left.self(), right.self());
+	}
+
+	// Without these Matrix::operator== converting the expression would be as good a match
+	template<class R>
+	bool operator==(const Matrix& left, const MatrixExpression<R>& right)
+	{
+		return equalElements(left, right.self());
+	}
+
+	template<class R>
+	bool operator!=(const Matrix& left, const MatrixExpression<R>& right)
+	{
+		return !equalElements(left, right.self());
+	}
+
+
+	template<class E>
+	Matrix::Matrix(const MatrixExpression<E>& e)
+	{
+		const E& expression = e.self();
+		allocate(expression.rowsCount, expression.columnsCount);
+		sweep(expression, [](double& element, double value) { element = value; });
+	}
+
+	template<class E>
+	Matrix& Matrix::operator=(const MatrixExpression<E>& e)
+	{
+		// The sweep would overwrite elements the expression still has to read,
+		// and reallocating would free them, if it reads this matrix out of
+		// place, as a = a.transposedView() does. Such expressions are evaluated
+		// into a new matrix that then takes the place of this one
+		const E& expression = e.self();
+		if (expression.aliases(view()))
+		{
+			return *this = Matrix(expression);
+		}
+		if (expression.rowsCount != rowsCount || expression.columnsCount != columnsCount)
+		{
+			reallocate(expression.rowsCount, expression.columnsCount);
+		}
+		sweep(expression, [](double& element, double value) { element = value; });
+		return *this;
+	}
+
+	template<class E>
+	Matrix& Matrix::operator+=(const MatrixExpression<E>& e)
+	{
+		const E& expression = e.self();
+		if (expression.rowsCount != rowsCount || expression.columnsCount != columnsCount)
+		{
+			throw SizeMismatchException();
+		}
+		update(expression, [](double& element, double value) { element += value; });
+		return *this;
+	}
+
+	template<class E>
+	Matrix& Matrix::operator-=(const MatrixExpression<E>& e)
+	{
+		const E& expression = e.self();
+		if (expression.rowsCount != rowsCount || expression.columnsCount != columnsCount)
+		{
+			throw SizeMismatchException();
+		}
+		update(expression, [](double& element, double value) { element -= value; });
+		return *this;
+	}
+
+	template<class E, class F>
+	void Matrix::update(const E& e, F f)
+	{
+		if (e.aliases(view()))
+		{
+			sweep(Matrix(e), f);
+			return;
+		}
+		sweep(e, f);
+	}
+
+	template<class E, class F>
+	void Matrix::sweep(const E& e, F f)
+	{
+		size_t grain = std::max<size_t>(1, parallel::SWEEP_GRAIN / std::max<size_t>(columnsCount, 1));
+		parallel::forRange(rowsCount, grain, [&](size_t begin, size_t end)
+		{
+			for (size_t i = begin; i < end; ++i)
+			{
+				double* row = buffer + i * stride;
+				for (size_t j = 0; j < columnsCount; ++j)
+				{
+					f(row[j], e.valueAt(i, j));
+				}
+			}
+		});
+	}
+
 
 	std::ostream& operator<<(std::ostream& output, const Matrix& matrix);
 	std::istream& operator>>(std::istream& input, Matrix& matrix);
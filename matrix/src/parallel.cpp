@@ -0,0 +1,152 @@
+#include "parallel.h"
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+using namespace task;
+
+namespace
+{
+	// Set on pool workers and on a caller while it helps, nested calls run serially
+	thread_local bool in_pool = false;
+
+	// Workers sleep until a batch of blocks is posted, then all of them and
+	// the posting thread take blocks off a shared counter until none are left
+	class ThreadPool
+	{
+	public:
+		explicit ThreadPool(size_t workers_count)
+		{
+			for (size_t i = 0; i < workers_count; ++i)
+			{
+				workers.emplace_back([this] { work(); });
+			}
+		}
+
+		~ThreadPool()
+		{
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				stopping = true;
+			}
+			wake.notify_all();
+			for (std::thread& worker : workers)
+			{
+				worker.join();
+			}
+		}
+
+		void run(size_t count, size_t grain, const std::function<void(size_t, size_t)>& f)
+		{
+			std::lock_guard<std::mutex> serial(run_mutex);
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				task = &f;
+				task_count = count;
+				task_grain = grain;
+				next_block.store(0, std::memory_order_relaxed);
+				busy_workers = workers.size();
+				++generation;
+			}
+			wake.notify_all();
+
+			in_pool = true;
+			runBlocks();
+			in_pool = false;
+
+			std::unique_lock<std::mutex> lock(mutex);
+			done.wait(lock, [this] { return busy_workers == 0; });
+		}
+
+	private:
+		std::vector<std::thread> workers;
+
+		// Only one batch runs at a time
+		std::mutex run_mutex;
+
+		std::mutex mutex;
+		std::condition_variable wake;
+		std::condition_variable done;
+		bool stopping = false;
+		size_t generation = 0;
+		size_t busy_workers = 0;
+
+		const std::function<void(size_t, size_t)>* task = nullptr;
+		size_t task_count = 0;
+		size_t task_grain = 1;
+		std::atomic<size_t> next_block{ 0 };
+
+		void runBlocks()
+		{
+			size_t blocks = (task_count + task_grain - 1) / task_grain;
+			for (size_t block; (block = next_block.fetch_add(1, std::memory_order_relaxed)) < blocks;)
+			{
+				size_t begin = block * task_grain;
+				(*task)(begin, std::min(begin + task_grain, task_count));
+			}
+		}
+
+		void work()
+		{
+			in_pool = true;
+			size_t seen = 0;
+			for (;;)
+			{
+				{
+					std::unique_lock<std::mutex> lock(mutex);
+					wake.wait(lock, [&] { return stopping || generation != seen; });
+					if (stopping)
+					{
+						return;
+					}
+					seen = generation;
+				}
+				runBlocks();
+				std::lock_guard<std::mutex> lock(mutex);
+				if (--busy_workers == 0)
+				{
+					done.notify_one();
+				}
+			}
+		}
+	};
+
+	std::atomic<size_t> thread_count{ 1 };
+	std::unique_ptr<ThreadPool> pool;
+}
+
+void parallel::setThreadCount(size_t count)
+{
+	if (count == 0)
+	{
+		count = std::max(1u, std::thread::hardware_concurrency());
+	}
+	pool.reset();
+	if (count > 1)
+	{
+		pool.reset(new ThreadPool(count - 1));
+	}
+	thread_count.store(count, std::memory_order_relaxed);
+}
+
+size_t parallel::threadCount()
+{
+	return thread_count.load(std::memory_order_relaxed);
+}
+
+void parallel::runBlocks(size_t count, size_t grain, const std::function<void(size_t, size_t)>& f)
+{
+	if (pool == nullptr || in_pool)
+	{
+		for (size_t begin = 0; begin < count; begin += grain)
+		{
+			f(begin, std::min(begin + grain, count));
+		}
+		return;
+	}
+	pool->run(count, grain, f);
+}
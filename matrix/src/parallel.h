@@ -0,0 +1,42 @@
+#pragma once
+
+#include <cstddef>
+#include <functional>
+
+
+namespace task {
+
+	namespace parallel {
+
+		// Elements below which splitting an element-wise op costs more than it saves
+		const size_t SWEEP_GRAIN = 1 << 15;
+
+		// Threads Matrix operations run on, the calling thread included.
+		// 1 runs everything serially, 0 picks one thread per core.
+		// Must not be called while other threads use matrices
+		void setThreadCount(size_t count);
+		size_t threadCount();
+
+		// Runs the blocks of [0, count) on the pool and waits for all of them
+		void runBlocks(size_t count, size_t grain, const std::function<void(size_t, size_t)>& f);
+
+		// Calls f(begin, end) for [0, count) cut into blocks of grain elements,
+		// the last one shorter. Blocks never depend on the thread count, so
+		// reductions combining per-block results are reproducible
+		template<class F>
+		void forRange(size_t count, size_t grain, F f)
+		{
+			if (count <= grain || threadCount() == 1)
+			{
+				for (size_t begin = 0; begin < count; begin += grain)
+				{
+					f(begin, begin + grain < count ? begin + grain : count);
+				}
+				return;
+			}
+			runBlocks(count, grain, f);
+		}
+
+	}  // namespace parallel
+
+}  // namespace task
@@ -0,0 +1,257 @@
+#include "serialization.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <system_error>
+#include <vector>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace task;
+
+namespace
+{
+	const size_t HEADER_SIZE = 32;
+	const char MAGIC[4] = { 'T', 'M', 'A', 'T' };
+	const uint8_t VERSION = 1;
+	const uint8_t FLOAT64 = 1;
+	const uint8_t LITTLE_ENDIAN_ORDER = 1;
+	const uint8_t BIG_ENDIAN_ORDER = 2;
+	// Step for streams that cannot report their length
+	const size_t READ_CHUNK = size_t(1) << 20;
+
+	uint8_t nativeOrder()
+	{
+		const uint16_t probe = 1;
+		uint8_t first;
+		std::memcpy(&first, &probe, 1);
+		return first == 1 ? LITTLE_ENDIAN_ORDER : BIG_ENDIAN_ORDER;
+	}
+
+	void swapBytes(char* value, size_t size)
+	{
+		std::reverse(value, value + size);
+	}
+
+	struct Header {
+		uint8_t order;
+		uint64_t rows;
+		uint64_t cols;
+	};
+
+	// Pipes and the like cannot tell how much is left, so the buffer only
+	// grows as fast as the bytes really arrive
+	std::vector<char> readGrowing(std::istream& input, size_t length)
+	{
+		std::vector<char> buffer;
+		while (buffer.size() < length)
+		{
+			size_t offset = buffer.size();
+			buffer.resize(offset + std::min(length - offset, READ_CHUNK));
+			if (!input.read(buffer.data() + offset, buffer.size() - offset))
+			{
+				throw FormatException();
+			}
+		}
+		return buffer;
+	}
+
+	// Checks everything but the byte order, which the caller decides how to handle
+	Header parseHeader(const char* bytes)
+	{
+		if (std::memcmp(bytes, MAGIC, sizeof(MAGIC)) != 0 || bytes[4] != VERSION || bytes[5] != FLOAT64
+			|| (bytes[6] != LITTLE_ENDIAN_ORDER && bytes[6] != BIG_ENDIAN_ORDER))
+		{
+			throw FormatException();
+		}
+		Header header;
+		header.order = bytes[6];
+		std::memcpy(&header.rows, bytes + 8, sizeof(uint64_t));
+		std::memcpy(&header.cols, bytes + 16, sizeof(uint64_t));
+		if (header.order != nativeOrder())
+		{
+			swapBytes(reinterpret_cast<char*>(&header.rows), sizeof(uint64_t));
+			swapBytes(reinterpret_cast<char*>(&header.cols), sizeof(uint64_t));
+		}
+		if (header.cols != 0 && header.rows > std::numeric_limits<size_t>::max() / sizeof(double) / header.cols)
+		{
+			throw FormatException();
+		}
+		return header;
+	}
+}
+
+void task::writeBinary(std::ostream& output, const Matrix& matrix)
+{
+	char header[HEADER_SIZE] = {};
+	std::memcpy(header, MAGIC, sizeof(MAGIC));
+	header[4] = VERSION;
+	header[5] = FLOAT64;
+	header[6] = nativeOrder();
+	uint64_t rows = matrix.rowsCount;
+	uint64_t cols = matrix.columnsCount;
+	std::memcpy(header + 8, &rows, sizeof(uint64_t));
+	std::memcpy(header + 16, &cols, sizeof(uint64_t));
+	output.write(header, HEADER_SIZE);
+
+	const char* data = reinterpret_cast<const char*>(matrix.data());
+	if (matrix.isContiguous())
+	{
+		output.write(data, matrix.rowsCount * matrix.columnsCount * sizeof(double));
+		return;
+	}
+	for (size_t i = 0; i < matrix.rowsCount && output; ++i)
+	{
+		output.write(data + i * matrix.getStride() * sizeof(double), matrix.columnsCount * sizeof(double));
+	}
+}
+
+Matrix task::readBinary(std::istream& input)
+{
+	char bytes[HEADER_SIZE];
+	if (!input.read(bytes, HEADER_SIZE))
+	{
+		throw FormatException();
+	}
+	Header header = parseHeader(bytes);
+	size_t size = header.rows * header.cols;
+	size_t length = size * sizeof(double);
+
+	// A header alone must not make us allocate, so the elements are looked for first
+	std::vector<char> buffered;
+	std::istream::pos_type start = input.tellg();
+	bool seekable = start != std::istream::pos_type(-1) && input.seekg(0, std::ios::end);
+	if (seekable)
+	{
+		std::istream::pos_type end = input.tellg();
+		if (end == std::istream::pos_type(-1) || !input.seekg(start) || static_cast<uint64_t>(end - start) < length)
+		{
+			throw FormatException();
+		}
+	}
+	else
+	{
+		input.clear();
+		buffered = readGrowing(input, length);
+	}
+
+	Matrix res(header.rows, header.cols, Matrix::Uninitialized());
+	char* data = reinterpret_cast<char*>(res.data());
+	if (!seekable)
+	{
+		std::copy(buffered.begin(), buffered.end(), data);
+	}
+	else if (!input.read(data, length))
+	{
+		throw FormatException();
+	}
+	if (header.order != nativeOrder())
+	{
+		for (size_t i = 0; i < size; ++i)
+		{
+			swapBytes(data + i * sizeof(double), sizeof(double));
+		}
+	}
+	return res;
+}
+
+void task::saveBinary(const std::string& path, const Matrix& matrix)
+{
+	std::ofstream output(path, std::ios::binary);
+	if (output)
+	{
+		writeBinary(output, matrix);
+		output.close();
+	}
+	if (!output)
+	{
+		throw std::system_error(errno, std::generic_category(), path);
+	}
+}
+
+Matrix task::loadBinary(const std::string& path)
+{
+	std::ifstream input(path, std::ios::binary);
+	if (!input)
+	{
+		throw std::system_error(errno, std::generic_category(), path);
+	}
+	return readBinary(input);
+}
+
+
+MappedMatrix::MappedMatrix(const std::string& path)
+{
+	int fd = open(path.c_str(), O_RDONLY);
+	if (fd < 0)
+	{
+		throw std::system_error(errno, std::generic_category(), path);
+	}
+	struct stat status;
+	if (fstat(fd, &status) != 0)
+	{
+		int error = errno;
+		close(fd);
+		throw std::system_error(error, std::generic_category(), path);
+	}
+	length = status.st_size;
+	if (length < HEADER_SIZE)
+	{
+		close(fd);
+		throw FormatException();
+	}
+	mapping = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+	int error = errno;
+	// The mapping keeps the file alive on its own
+	close(fd);
+	if (mapping == MAP_FAILED)
+	{
+		throw std::system_error(error, std::generic_category(), path);
+	}
+
+	const char* bytes = static_cast<const char*>(mapping);
+	try
+	{
+		Header header = parseHeader(bytes);
+		// Swapping would mean writing to every page, which a zero-copy view cannot do
+		if (header.order != nativeOrder() || length - HEADER_SIZE < header.rows * header.cols * sizeof(double))
+		{
+			throw FormatException();
+		}
+		rowsCount = header.rows;
+		columnsCount = header.cols;
+	}
+	catch (...)
+	{
+		munmap(mapping, length);
+		throw;
+	}
+	elements = reinterpret_cast<const double*>(bytes + HEADER_SIZE);
+}
+
+MappedMatrix::MappedMatrix(MappedMatrix&& other) noexcept
+	: rowsCount(other.rowsCount), columnsCount(other.columnsCount),
+	  mapping(other.mapping), length(other.length), elements(other.elements)
+{
+	other.mapping = nullptr;
+	other.rowsCount = other.columnsCount = other.length = 0;
+	other.elements = nullptr;
+}
+
+MappedMatrix::~MappedMatrix()
+{
+	if (mapping != nullptr)
+	{
+		munmap(mapping, length);
+	}
+}
+
+const double* MappedMatrix::data() const
+{
+	return elements;
+}
@@ -0,0 +1,80 @@
+#pragma once
+
+#include <iostream>
+#include <string>
+#include "matrix.h"
+
+
+namespace task {
+
+	// Binary matrix files: a 32 byte header, then the elements row by row as
+	// raw doubles. The header holds
+	//   0  magic "TMAT"
+	//   4  format version, 1
+	//   5  element type, 1 for 64-bit IEEE 754 double
+	//   6  byte order of the header numbers and the elements, 1 little, 2 big endian
+	//   8  rows, 64-bit unsigned
+	//   16 columns, 64-bit unsigned
+	//   24 reserved, zero
+	// Files are written in the byte order of the machine writing them
+
+	// Header missing, of another format or version, or elements cut short
+	class FormatException : public std::exception {};
+
+	// Writes the header, then the rows straight from the matrix storage.
+	// Stream errors are left in the stream state
+	void writeBinary(std::ostream& output, const Matrix& matrix);
+	// Reads a matrix in either byte order. Throws FormatException, before
+	// allocating anything, if the stream holds fewer elements than the header says
+	Matrix readBinary(std::istream& input);
+
+	// Throw std::system_error if the file cannot be opened
+	void saveBinary(const std::string& path, const Matrix& matrix);
+	Matrix loadBinary(const std::string& path);
+
+
+	// Read-only matrix whose elements are a binary file mapped into memory:
+	// opening it copies nothing and pages are read from disk on first touch.
+	// It can be used in element-wise expressions and converted to a Matrix.
+	// Throws std::system_error if the file cannot be mapped and
+	// FormatException if it is malformed or in the other byte order
+	class MappedMatrix : public MatrixExpression<MappedMatrix> {
+
+	public:
+
+		explicit MappedMatrix(const std::string& path);
+		MappedMatrix(MappedMatrix&& other) noexcept;
+		~MappedMatrix();
+
+		MappedMatrix(const MappedMatrix&) = delete;
+		MappedMatrix& operator=(const MappedMatrix&) = delete;
+
+		// Contiguous row-major elements inside the mapping
+		const double* data() const;
+
+		double valueAt(size_t row, size_t col) const
+		{
+			return elements[row * columnsCount + col];
+		}
+
+		// A private read-only mapping is never the storage of a Matrix
+		bool aliases(const ConstMatrixView&) const
+		{
+			return false;
+		}
+
+		size_t rowsCount;
+		size_t columnsCount;
+	private:
+		void* mapping;
+		size_t length;
+		const double* elements;
+	};
+
+	// Cannot be copied into expression nodes
+	template<>
+	struct Operand<MappedMatrix> {
+		using type = const MappedMatrix&;
+	};
+
+}  // namespace task
@@ -0,0 +1,359 @@
+#include "simd.h"
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define TASK_SIMD_X86
+#endif
+
+using namespace task;
+using namespace task::simd;
+
+namespace
+{
+	struct Kernels
+	{
+		void (*add)(double*, const double*, size_t);
+		void (*sub)(double*, const double*, size_t);
+		void (*scale)(double*, double, size_t);
+		void (*axpy)(double*, double, const double*, size_t);
+		bool (*equal)(const double*, const double*, size_t, double);
+	};
+
+	// Portable kernels, also used for the tails the vector loops leave over
+
+	void addScalar(double* dst, const double* src, size_t n)
+	{
+		for (size_t i = 0; i < n; ++i)
+		{
+			dst[i] += src[i];
+		}
+	}
+
+	void subScalar(double* dst, const double* src, size_t n)
+	{
+		for (size_t i = 0; i < n; ++i)
+		{
+			dst[i] -= src[i];
+		}
+	}
+
+	void scaleScalar(double* dst, double factor, size_t n)
+	{
+		for (size_t i = 0; i < n; ++i)
+		{
+			dst[i] *= factor;
+		}
+	}
+
+	void axpyScalar(double* dst, double factor, const double* src, size_t n)
+	{
+		for (size_t i = 0; i < n; ++i)
+		{
+			dst[i] += factor * src[i];
+		}
+	}
+
+	bool equalScalar(const double* a, const double* b, size_t n, double eps)
+	{
+		for (size_t i = 0; i < n; ++i)
+		{
+			if (std::abs(a[i] - b[i]) > eps)
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+
+	const Kernels SCALAR = { addScalar, subScalar, scaleScalar, axpyScalar, equalScalar };
+
+#ifdef TASK_SIMD_X86
+
+	// SSE2 is part of x86-64, so these need no target attribute there
+
+	__attribute__((target("sse2"))) void addSse2(double* dst, const double* src, size_t n)
+	{
+		size_t i = 0;
+		for (; i + 2 <= n; i += 2)
+		{
+			_mm_storeu_pd(dst + i, _mm_add_pd(_mm_loadu_pd(dst + i), _mm_loadu_pd(src + i)));
+		}
+		addScalar(dst + i, src + i, n - i);
+	}
+
+	__attribute__((target("sse2"))) void subSse2(double* dst, const double* src, size_t n)
+	{
+		size_t i = 0;
+		for (; i + 2 <= n; i += 2)
+		{
+			_mm_storeu_pd(dst + i, _mm_sub_pd(_mm_loadu_pd(dst + i), _mm_loadu_pd(src + i)));
+		}
+		subScalar(dst + i, src + i, n - i);
+	}
+
+	__attribute__((target("sse2"))) void scaleSse2(double* dst, double factor, size_t n)
+	{
+		__m128d f = _mm_set1_pd(factor);
+		size_t i = 0;
+		for (; i + 2 <= n; i += 2)
+		{
+			_mm_storeu_pd(dst + i, _mm_mul_pd(_mm_loadu_pd(dst + i), f));
+		}
+		scaleScalar(dst + i, factor, n - i);
+	}
+
+	__attribute__((target("sse2"))) void axpySse2(double* dst, double factor, const double* src, size_t n)
+	{
+		__m128d f = _mm_set1_pd(factor);
+		size_t i = 0;
+		for (; i + 2 <= n; i += 2)
+		{
+			_mm_storeu_pd(dst + i, _mm_add_pd(_mm_loadu_pd(dst + i), _mm_mul_pd(f, _mm_loadu_pd(src + i))));
+		}
+		axpyScalar(dst + i, factor, src + i, n - i);
+	}
+
+	__attribute__((target("sse2"))) bool equalSse2(const double* a, const double* b, size_t n, double eps)
+	{
+		// Clearing the sign bit gives the absolute value, an ordered compare
+		// treats NaN differences as equal just like the scalar kernel
+		__m128d abs_mask = _mm_castsi128_pd(_mm_set1_epi64x(0x7fffffffffffffffLL));
+		__m128d e = _mm_set1_pd(eps);
+		size_t i = 0;
+		for (; i + 2 <= n; i += 2)
+		{
+			__m128d diff = _mm_and_pd(_mm_sub_pd(_mm_loadu_pd(a + i), _mm_loadu_pd(b + i)), abs_mask);
+			if (_mm_movemask_pd(_mm_cmpgt_pd(diff, e)) != 0)
+			{
+				return false;
+			}
+		}
+		return equalScalar(a + i, b + i, n - i, eps);
+	}
+
+	const Kernels SSE2 = { addSse2, subSse2, scaleSse2, axpySse2, equalSse2 };
+
+	__attribute__((target("avx2"))) void addAvx2(double* dst, const double* src, size_t n)
+	{
+		size_t i = 0;
+		for (; i + 4 <= n; i += 4)
+		{
+			_mm256_storeu_pd(dst + i, _mm256_add_pd(_mm256_loadu_pd(dst + i), _mm256_loadu_pd(src + i)));
+		}
+		addScalar(dst + i, src + i, n - i);
+	}
+
+	__attribute__((target("avx2"))) void subAvx2(double* dst, const double* src, size_t n)
+	{
+		size_t i = 0;
+		for (; i + 4 <= n; i += 4)
+		{
+			_mm256_storeu_pd(dst + i, _mm256_sub_pd(_mm256_loadu_pd(dst + i), _mm256_loadu_pd(src + i)));
+		}
+		subScalar(dst + i, src + i, n - i);
+	}
+
+	__attribute__((target("avx2"))) void scaleAvx2(double* dst, double factor, size_t n)
+	{
+		__m256d f = _mm256_set1_pd(factor);
+		size_t i = 0;
+		for (; i + 4 <= n; i += 4)
+		{
+			_mm256_storeu_pd(dst + i, _mm256_mul_pd(_mm256_loadu_pd(dst + i), f));
+		}
+		scaleScalar(dst + i, factor, n - i);
+	}
+
+	// Multiply and add are kept separate so every instruction set rounds alike
+	__attribute__((target("avx2"))) void axpyAvx2(double* dst, double factor, const double* src, size_t n)
+	{
+		__m256d f = _mm256_set1_pd(factor);
+		size_t i = 0;
+		for (; i + 4 <= n; i += 4)
+		{
+			_mm256_storeu_pd(dst + i, _mm256_add_pd(_mm256_loadu_pd(dst + i), _mm256_mul_pd(f, _mm256_loadu_pd(src + i))));
+		}
+		axpyScalar(dst + i, factor, src + i, n - i);
+	}
+
+	__attribute__((target("avx2"))) bool equalAvx2(const double* a, const double* b, size_t n, double eps)
+	{
+		__m256d abs_mask = _mm256_castsi256_pd(_mm256_set1_epi64x(0x7fffffffffffffffLL));
+		__m256d e = _mm256_set1_pd(eps);
+		size_t i = 0;
+		for (; i + 4 <= n; i += 4)
+		{
+			__m256d diff = _mm256_and_pd(_mm256_sub_pd(_mm256_loadu_pd(a + i), _mm256_loadu_pd(b + i)), abs_mask);
+			if (_mm256_movemask_pd(_mm256_cmp_pd(diff, e, _CMP_GT_OQ)) != 0)
+			{
+				return false;
+			}
+		}
+		return equalScalar(a + i, b + i, n - i, eps);
+	}
+
+	const Kernels AVX2 = { addAvx2, subAvx2, scaleAvx2, axpyAvx2, equalAvx2 };
+
+	__attribute__((target("avx512f"))) void addAvx512(double* dst, const double* src, size_t n)
+	{
+		size_t i = 0;
+		for (; i + 8 <= n; i += 8)
+		{
+			_mm512_storeu_pd(dst + i, _mm512_add_pd(_mm512_loadu_pd(dst + i), _mm512_loadu_pd(src + i)));
+		}
+		addScalar(dst + i, src + i, n - i);
+	}
+
+	__attribute__((target("avx512f"))) void subAvx512(double* dst, const double* src, size_t n)
+	{
+		size_t i = 0;
+		for (; i + 8 <= n; i += 8)
+		{
+			_mm512_storeu_pd(dst + i, _mm512_sub_pd(_mm512_loadu_pd(dst + i), _mm512_loadu_pd(src + i)));
+		}
+		subScalar(dst + i, src + i, n - i);
+	}
+
+	__attribute__((target("avx512f"))) void scaleAvx512(double* dst, double factor, size_t n)
+	{
+		__m512d f = _mm512_set1_pd(factor);
+		size_t i = 0;
+		for (; i + 8 <= n; i += 8)
+		{
+			_mm512_storeu_pd(dst + i, _mm512_mul_pd(_mm512_loadu_pd(dst + i), f));
+		}
+		scaleScalar(dst + i, factor, n - i);
+	}
+
+	__attribute__((target("avx512f"))) void axpyAvx512(double* dst, double factor, const double* src, size_t n)
+	{
+		__m512d f = _mm512_set1_pd(factor);
+		size_t i = 0;
+		for (; i + 8 <= n; i += 8)
+		{
+			_mm512_storeu_pd(dst + i, _mm512_add_pd(_mm512_loadu_pd(dst + i), _mm512_mul_pd(f, _mm512_loadu_pd(src + i))));
+		}
+		axpyScalar(dst + i, factor, src + i, n - i);
+	}
+
+	__attribute__((target("avx512f"))) bool equalAvx512(const double* a, const double* b, size_t n, double eps)
+	{
+		__m512d e = _mm512_set1_pd(eps);
+		size_t i = 0;
+		for (; i + 8 <= n; i += 8)
+		{
+			__m512d diff = _mm512_abs_pd(_mm512_sub_pd(_mm512_loadu_pd(a + i), _mm512_loadu_pd(b + i)));
+			if (_mm512_cmp_pd_mask(diff, e, _CMP_GT_OQ) != 0)
+			{
+				return false;
+			}
+		}
+		return equalScalar(a + i, b + i, n - i, eps);
+	}
+
+	const Kernels AVX512 = { addAvx512, subAvx512, scaleAvx512, axpyAvx512, equalAvx512 };
+
+#endif
+
+	const Kernels& kernelsFor(Isa isa)
+	{
+		switch (isa)
+		{
+#ifdef TASK_SIMD_X86
+		case Isa::Avx512:
+			return AVX512;
+		case Isa::Avx2:
+			return AVX2;
+		case Isa::Sse2:
+			return SSE2;
+#endif
+		default:
+			return SCALAR;
+		}
+	}
+
+	Isa detect()
+	{
+#ifdef TASK_SIMD_X86
+		// Queries CPUID, including whether the OS saves the wider registers
+		__builtin_cpu_init();
+		if (__builtin_cpu_supports("avx512f"))
+			return Isa::Avx512;
+		if (__builtin_cpu_supports("avx2"))
+			return Isa::Avx2;
+		if (__builtin_cpu_supports("sse2"))
+			return Isa::Sse2;
+#endif
+		return Isa::Scalar;
+	}
+
+	std::atomic<Isa>& active()
+	{
+		static std::atomic<Isa> isa{ detectedIsa() };
+		return isa;
+	}
+
+	const Kernels& kernels()
+	{
+		return kernelsFor(active().load(std::memory_order_relaxed));
+	}
+}
+
+Isa simd::detectedIsa()
+{
+	static const Isa isa = detect();
+	return isa;
+}
+
+Isa simd::activeIsa()
+{
+	return active().load(std::memory_order_relaxed);
+}
+
+void simd::useIsa(Isa isa)
+{
+	active().store(std::min(isa, detectedIsa()), std::memory_order_relaxed);
+}
+
+const char* simd::isaName(Isa isa)
+{
+	switch (isa)
+	{
+	case Isa::Avx512:
+		return "avx512";
+	case Isa::Avx2:
+		return "avx2";
+	case Isa::Sse2:
+		return "sse2";
+	default:
+		return "scalar";
+	}
+}
+
+void simd::add(double* dst, const double* src, size_t n)
+{
+	kernels().add(dst, src, n);
+}
+
+void simd::sub(double* dst, const double* src, size_t n)
+{
+	kernels().sub(dst, src, n);
+}
+
+void simd::scale(double* dst, double factor, size_t n)
+{
+	kernels().scale(dst, factor, n);
+}
+
+void simd::axpy(double* dst, double factor, const double* src, size_t n)
+{
+	kernels().axpy(dst, factor, src, n);
+}
+
+bool simd::equal(const double* a, const double* b, size_t n, double eps)
+{
+	return kernels().equal(a, b, n, eps);
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <cstddef>
+
+
+namespace task {
+
+	namespace simd {
+
+		// Instruction sets the kernels are compiled for, in order of preference
+		enum class Isa { Scalar, Sse2, Avx2, Avx512 };
+
+		// Best instruction set the running CPU supports
+		Isa detectedIsa();
+
+		// Instruction set the kernels currently dispatch to
+		Isa activeIsa();
+
+		// Forces the kernels to a given instruction set, clamped to detectedIsa()
+		void useIsa(Isa isa);
+
+		const char* isaName(Isa isa);
+
+		// dst[i] += src[i]
+		void add(double* dst, const double* src, size_t n);
+
+		// dst[i] -= src[i]
+		void sub(double* dst, const double* src, size_t n);
+
+		// dst[i] *= factor
+		void scale(double* dst, double factor, size_t n);
+
+		// dst[i] += factor * src[i]
+		void axpy(double* dst, double factor, const double* src, size_t n);
+
+		// |a[i] - b[i]| <= eps for every i
+		bool equal(const double* a, const double* b, size_t n, double eps);
+
+	}  // namespace simd
+
+}  // namespace task
@@ -0,0 +1,353 @@
+#include "sparse.h"
+#include "parallel.h"
+#include "simd.h"
+#include <algorithm>
+#include <cmath>
+#include <utility>
+
+using namespace task;
+
+namespace
+{
+	// Dense accumulator for one row of a sparse product. Every thread keeps
+	// its own between blocks and calls, grown to the widest product so far.
+	// A column belongs to the current row only if its marker holds the
+	// row's stamp, and stamps only grow, so nothing is ever cleared
+	struct RowAccumulator
+	{
+		std::vector<double> values;
+		std::vector<size_t> marker;
+		std::vector<size_t> touched;
+		size_t stamp = 0;
+	};
+
+	RowAccumulator& rowAccumulator(size_t cols)
+	{
+		thread_local RowAccumulator accumulator;
+		if (accumulator.values.size() < cols)
+		{
+			accumulator.values.resize(cols);
+			accumulator.marker.resize(cols, 0);
+		}
+		return accumulator;
+	}
+}
+
+SparseMatrix::SparseMatrix(size_t rows, size_t cols)
+	: rowsCount(rows), columnsCount(cols), rowStarts(rows + 1, 0) {}
+
+SparseMatrix::SparseMatrix(size_t rows, size_t cols, std::vector<Triplet> triplets)
+	: rowsCount(rows), columnsCount(cols), rowStarts(rows + 1, 0)
+{
+	for (const Triplet& triplet : triplets)
+	{
+		if (triplet.row >= rows || triplet.col >= cols)
+		{
+			throw OutOfBoundsException();
+		}
+	}
+	std::sort(triplets.begin(), triplets.end(), [](const Triplet& left, const Triplet& right)
+	{
+		return left.row != right.row ? left.row < right.row : left.col < right.col;
+	});
+
+	columnIndices.reserve(triplets.size());
+	values.reserve(triplets.size());
+	for (size_t i = 0; i < triplets.size(); ++i)
+	{
+		const Triplet& triplet = triplets[i];
+		if (i != 0 && triplet.row == triplets[i - 1].row && triplet.col == triplets[i - 1].col)
+		{
+			values.back() += triplet.value;
+			continue;
+		}
+		columnIndices.push_back(triplet.col);
+		values.push_back(triplet.value);
+		++rowStarts[triplet.row + 1];
+	}
+	for (size_t i = 0; i < rows; ++i)
+	{
+		rowStarts[i + 1] += rowStarts[i];
+	}
+}
+
+SparseMatrix::SparseMatrix(const Matrix& dense, double tolerance)
+	: rowsCount(dense.rowsCount), columnsCount(dense.columnsCount), rowStarts(dense.rowsCount + 1, 0)
+{
+	// Nonzeros of every row are counted first, so each row knows where it
+	// starts and the rows can be filled in parallel
+	size_t grain = std::max<size_t>(1, parallel::SWEEP_GRAIN / std::max<size_t>(columnsCount, 1));
+	parallel::forRange(rowsCount, grain, [&](size_t begin, size_t end)
+	{
+		for (size_t i = begin; i < end; ++i)
+		{
+			size_t count = 0;
+			for (size_t j = 0; j < columnsCount; ++j)
+			{
+				count += std::abs(dense.valueAt(i, j)) > tolerance;
+			}
+			rowStarts[i + 1] = count;
+		}
+	});
+	for (size_t i = 0; i < rowsCount; ++i)
+	{
+		rowStarts[i + 1] += rowStarts[i];
+	}
+
+	columnIndices.resize(rowStarts[rowsCount]);
+	values.resize(rowStarts[rowsCount]);
+	parallel::forRange(rowsCount, grain, [&](size_t begin, size_t end)
+	{
+		for (size_t i = begin; i < end; ++i)
+		{
+			size_t next = rowStarts[i];
+			for (size_t j = 0; j < columnsCount; ++j)
+			{
+				double value = dense.valueAt(i, j);
+				if (std::abs(value) > tolerance)
+				{
+					columnIndices[next] = j;
+					values[next++] = value;
+				}
+			}
+		}
+	});
+}
+
+Matrix SparseMatrix::toDense() const
+{
+	// Every row is zeroed by the thread that scatters into it
+	Matrix res(rowsCount, columnsCount, Matrix::Uninitialized());
+	double* dst = res.data();
+	size_t stride = res.getStride();
+	parallel::forRange(rowsCount, rowGrain(), [&](size_t begin, size_t end)
+	{
+		for (size_t i = begin; i < end; ++i)
+		{
+			std::fill(dst + i * stride, dst + i * stride + columnsCount, 0.0);
+			for (size_t p = rowStarts[i]; p < rowStarts[i + 1]; ++p)
+			{
+				dst[i * stride + columnIndices[p]] = values[p];
+			}
+		}
+	});
+	return res;
+}
+
+double SparseMatrix::get(size_t row, size_t col) const
+{
+	if (row >= rowsCount || col >= columnsCount)
+	{
+		throw OutOfBoundsException();
+	}
+	auto begin = columnIndices.begin() + rowStarts[row];
+	auto end = columnIndices.begin() + rowStarts[row + 1];
+	auto found = std::lower_bound(begin, end, col);
+	return found != end && *found == col ? values[found - columnIndices.begin()] : 0.0;
+}
+
+size_t SparseMatrix::nonZerosCount() const
+{
+	return values.size();
+}
+
+size_t SparseMatrix::rowGrain() const
+{
+	return std::max<size_t>(1, parallel::SWEEP_GRAIN * rowsCount / std::max<size_t>(values.size(), 1));
+}
+
+void SparseMatrix::multiply(const double* x, double* y) const
+{
+	parallel::forRange(rowsCount, rowGrain(), [&](size_t begin, size_t end)
+	{
+		for (size_t i = begin; i < end; ++i)
+		{
+			double sum = 0;
+			for (size_t p = rowStarts[i]; p < rowStarts[i + 1]; ++p)
+			{
+				sum += values[p] * x[columnIndices[p]];
+			}
+			y[i] = sum;
+		}
+	});
+}
+
+Matrix SparseMatrix::operator*(const Matrix& dense) const
+{
+	if (columnsCount != dense.rowsCount)
+	{
+		throw SizeMismatchException();
+	}
+	Matrix res(rowsCount, dense.columnsCount, Matrix::Uninitialized());
+	if (dense.columnsCount == 1 && dense.getStride() == 1)
+	{
+		multiply(dense.data(), res.data());
+		return res;
+	}
+
+	// Row i of the product is a sum of the rows of the dense matrix picked
+	// by the nonzeros of row i
+	size_t cols = dense.columnsCount;
+	const double* src = dense.data();
+	size_t ld = dense.getStride();
+	parallel::forRange(rowsCount, std::max<size_t>(1, rowGrain() / std::max<size_t>(cols, 1)), [&](size_t begin, size_t end)
+	{
+		for (size_t i = begin; i < end; ++i)
+		{
+			double* row = res[i];
+			std::fill(row, row + cols, 0.0);
+			for (size_t p = rowStarts[i]; p < rowStarts[i + 1]; ++p)
+			{
+				simd::axpy(row, values[p], src + columnIndices[p] * ld, cols);
+			}
+		}
+	});
+	return res;
+}
+
+SparseMatrix SparseMatrix::operator*(const SparseMatrix& a) const
+{
+	if (columnsCount != a.rowsCount)
+	{
+		throw SizeMismatchException();
+	}
+
+	// Row by row, each row of the product accumulated in the thread's dense
+	// row with a marker of the columns it touched. Blocks of rows are
+	// multiplied in parallel into their own arrays and then concatenated in order
+	struct Block {
+		std::vector<size_t> columnIndices;
+		std::vector<double> values;
+	};
+	size_t grain = rowGrain();
+	std::vector<Block> blocks((rowsCount + grain - 1) / grain);
+	SparseMatrix res(rowsCount, a.columnsCount);
+
+	parallel::forRange(rowsCount, grain, [&](size_t begin, size_t end)
+	{
+		Block& block = blocks[begin / grain];
+		RowAccumulator& accumulator = rowAccumulator(a.columnsCount);
+		std::vector<size_t>& touched = accumulator.touched;
+		for (size_t i = begin; i < end; ++i)
+		{
+			size_t stamp = ++accumulator.stamp;
+			touched.clear();
+			for (size_t p = rowStarts[i]; p < rowStarts[i + 1]; ++p)
+			{
+				size_t k = columnIndices[p];
+				for (size_t q = a.rowStarts[k]; q < a.rowStarts[k + 1]; ++q)
+				{
+					size_t j = a.columnIndices[q];
+					if (accumulator.marker[j] != stamp)
+					{
+						accumulator.marker[j] = stamp;
+						accumulator.values[j] = 0;
+						touched.push_back(j);
+					}
+					accumulator.values[j] += values[p] * a.values[q];
+				}
+			}
+			std::sort(touched.begin(), touched.end());
+			for (size_t j : touched)
+			{
+				block.columnIndices.push_back(j);
+				block.values.push_back(accumulator.values[j]);
+			}
+			res.rowStarts[i + 1] = touched.size();
+		}
+	});
+
+	for (size_t i = 0; i < rowsCount; ++i)
+	{
+		res.rowStarts[i + 1] += res.rowStarts[i];
+	}
+	res.columnIndices.reserve(res.rowStarts[rowsCount]);
+	res.values.reserve(res.rowStarts[rowsCount]);
+	for (const Block& block : blocks)
+	{
+		res.columnIndices.insert(res.columnIndices.end(), block.columnIndices.begin(), block.columnIndices.end());
+		res.values.insert(res.values.end(), block.values.begin(), block.values.end());
+	}
+	return res;
+}
+
+SparseMatrix SparseMatrix::transposed() const
+{
+	// Counting sort of the nonzeros by column. Rows are visited in order,
+	// so every row of the result comes out sorted
+	SparseMatrix res(columnsCount, rowsCount);
+	for (size_t col : columnIndices)
+	{
+		++res.rowStarts[col + 1];
+	}
+	for (size_t j = 0; j < columnsCount; ++j)
+	{
+		res.rowStarts[j + 1] += res.rowStarts[j];
+	}
+
+	res.columnIndices.resize(values.size());
+	res.values.resize(values.size());
+	std::vector<size_t> next(res.rowStarts.begin(), res.rowStarts.end() - 1);
+	for (size_t i = 0; i < rowsCount; ++i)
+	{
+		for (size_t p = rowStarts[i]; p < rowStarts[i + 1]; ++p)
+		{
+			size_t q = next[columnIndices[p]]++;
+			res.columnIndices[q] = i;
+			res.values[q] = values[p];
+		}
+	}
+	return res;
+}
+
+const std::vector<size_t>& SparseMatrix::getRowStarts() const
+{
+	return rowStarts;
+}
+
+const std::vector<size_t>& SparseMatrix::getColumnIndices() const
+{
+	return columnIndices;
+}
+
+const std::vector<double>& SparseMatrix::getValues() const
+{
+	return values;
+}
+
+
+Matrix task::operator*(const Matrix& dense, const SparseMatrix& sparse)
+{
+	if (dense.columnsCount != sparse.rowsCount)
+	{
+		throw SizeMismatchException();
+	}
+	const std::vector<size_t>& starts = sparse.getRowStarts();
+	const std::vector<size_t>& columns = sparse.getColumnIndices();
+	const std::vector<double>& values = sparse.getValues();
+
+	// Row i of the product is a sum of the sparse rows weighted by row i of the dense matrix
+	Matrix res(dense.rowsCount, sparse.columnsCount, Matrix::Uninitialized());
+	size_t grain = std::max<size_t>(1, parallel::SWEEP_GRAIN / std::max<size_t>(dense.columnsCount, 1));
+	parallel::forRange(dense.rowsCount, grain, [&](size_t begin, size_t end)
+	{
+		for (size_t i = begin; i < end; ++i)
+		{
+			double* row = res[i];
+			std::fill(row, row + res.columnsCount, 0.0);
+			for (size_t k = 0; k < dense.columnsCount; ++k)
+			{
+				double factor = dense.valueAt(i, k);
+				if (factor == 0)
+				{
+					continue;
+				}
+				for (size_t p = starts[k]; p < starts[k + 1]; ++p)
+				{
+					row[columns[p]] += factor * values[p];
+				}
+			}
+		}
+	});
+	return res;
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <vector>
+#include "matrix.h"
+
+
+namespace task {
+
+	// Nonzero element (row, col) of a sparse matrix
+	struct Triplet {
+		size_t row;
+		size_t col;
+		double value;
+	};
+
+
+	// Compressed sparse row matrix: memory and time scale with the nonzeros.
+	// The CSR arrays of the transpose are the CSC arrays of the matrix, so
+	// transposed() is also the CSR to CSC conversion
+	class SparseMatrix {
+
+	public:
+
+		// All zeros
+		SparseMatrix(size_t rows, size_t cols);
+		// Duplicates are summed, zeros kept. Throws OutOfBoundsException
+		SparseMatrix(size_t rows, size_t cols, std::vector<Triplet> triplets);
+		// Keeps the elements with |value| > tolerance
+		explicit SparseMatrix(const Matrix& dense, double tolerance = 0);
+
+		Matrix toDense() const;
+
+		// Binary search in the row, throws OutOfBoundsException
+		double get(size_t row, size_t col) const;
+		size_t nonZerosCount() const;
+
+		// y = A x, x has columnsCount elements and y rowsCount
+		void multiply(const double* x, double* y) const;
+
+		Matrix operator*(const Matrix& dense) const;
+		SparseMatrix operator*(const SparseMatrix& a) const;
+		SparseMatrix transposed() const;
+
+		// Row i holds values[rowStarts[i] .. rowStarts[i + 1]) in columns
+		// columnIndices[...] of the same range, sorted within each row
+		const std::vector<size_t>& getRowStarts() const;
+		const std::vector<size_t>& getColumnIndices() const;
+		const std::vector<double>& getValues() const;
+
+		size_t rowsCount;
+		size_t columnsCount;
+	private:
+		std::vector<size_t> rowStarts;
+		std::vector<size_t> columnIndices;
+		std::vector<double> values;
+
+		// Rows per block on the pool, so that a block holds about SWEEP_GRAIN nonzeros
+		size_t rowGrain() const;
+	};
+
+	Matrix operator*(const Matrix& dense, const SparseMatrix& sparse);
+
+}  // namespace task
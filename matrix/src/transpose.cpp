@@ -0,0 +1,141 @@
+#include "transpose.h"
+#include "parallel.h"
+#include <algorithm>
+#include <utility>
+
+using namespace task;
+
+namespace
+{
+	// Source and destination tiles stay in L1 even when a power-of-two
+	// leading dimension maps all their rows to the same few cache sets
+	const size_t TILE = 16;
+
+	void transposeTile(size_t rows, size_t cols, const double* src, size_t lds, double* dst, size_t ldd)
+	{
+		for (size_t i = 0; i < rows; ++i)
+		{
+			for (size_t j = 0; j < cols; ++j)
+			{
+				dst[j * ldd + i] = src[i * lds + j];
+			}
+		}
+	}
+
+	// Exchanges tile (i, j) with the transpose of tile (j, i)
+	void swapTiles(size_t rows, size_t cols, double* upper, double* lower, size_t ld)
+	{
+		for (size_t i = 0; i < rows; ++i)
+		{
+			for (size_t j = 0; j < cols; ++j)
+			{
+				std::swap(upper[i * ld + j], lower[j * ld + i]);
+			}
+		}
+	}
+}
+
+void task::transposeRuns(size_t rows, size_t cols, size_t length, double* data)
+{
+	// Run k = i * cols + j belongs at j * rows + i. The permutation splits
+	// into cycles, each rotated once from its smallest position: walking the
+	// cycle from start until a smaller position shows up tells whether start
+	// leads it, so no memory is needed to mark the runs already moved.
+	// The first and the last run never move
+	size_t count = rows * cols;
+	auto destination = [rows, cols](size_t position)
+	{
+		return position % cols * rows + position / cols;
+	};
+	for (size_t start = 1; start + 1 < count; ++start)
+	{
+		size_t position = destination(start);
+		while (position > start)
+		{
+			position = destination(position);
+		}
+		if (position < start)
+		{
+			continue;
+		}
+		// The run at start carries the displaced one around the cycle
+		double* carried = data + start * length;
+		for (position = destination(start); position != start; position = destination(position))
+		{
+			std::swap_ranges(carried, carried + length, data + position * length);
+		}
+	}
+}
+
+void task::transpose(size_t rows, size_t cols, const double* src, size_t lds, double* dst, size_t ldd)
+{
+	size_t tile_rows = (rows + TILE - 1) / TILE;
+	parallel::forRange(tile_rows, 1, [&](size_t begin, size_t end)
+	{
+		for (size_t i = begin * TILE; i < std::min(end * TILE, rows); i += TILE)
+		{
+			for (size_t j = 0; j < cols; j += TILE)
+			{
+				transposeTile(std::min(TILE, rows - i), std::min(TILE, cols - j),
+					src + i * lds + j, lds, dst + j * ldd + i, ldd);
+			}
+		}
+	});
+}
+
+void task::transposeSquare(size_t n, double* data, size_t ld)
+{
+	// Each tile row swaps with the tile column mirroring it, the diagonal tile
+	// is swapped with itself above its diagonal
+	size_t tiles = (n + TILE - 1) / TILE;
+	parallel::forRange(tiles, 1, [&](size_t begin, size_t end)
+	{
+		for (size_t tile = begin; tile < end; ++tile)
+		{
+			size_t i = tile * TILE;
+			size_t size = std::min(TILE, n - i);
+			double* diagonal = data + i * ld + i;
+			for (size_t r = 0; r < size; ++r)
+			{
+				for (size_t c = r + 1; c < size; ++c)
+				{
+					std::swap(diagonal[r * ld + c], diagonal[c * ld + r]);
+				}
+			}
+			for (size_t j = i + TILE; j < n; j += TILE)
+			{
+				swapTiles(size, std::min(TILE, n - j), data + i * ld + j, data + j * ld + i, ld);
+			}
+		}
+	});
+}
+
+void task::transposeInPlace(size_t rows, size_t cols, double* data)
+{
+	if (rows == cols)
+	{
+		transposeSquare(rows, data, cols);
+		return;
+	}
+	// A matrix of whole square blocks is transposed block by block with the
+	// tiled kernel, moving the blocks' rows as runs before or after that
+	if (rows % cols == 0)
+	{
+		for (size_t block = 0; block < rows / cols; ++block)
+		{
+			transposeSquare(cols, data + block * cols * cols, cols);
+		}
+		transposeRuns(rows / cols, cols, cols, data);
+		return;
+	}
+	if (cols % rows == 0)
+	{
+		transposeRuns(rows, cols / rows, rows, data);
+		for (size_t block = 0; block < cols / rows; ++block)
+		{
+			transposeSquare(rows, data + block * rows * rows, rows);
+		}
+		return;
+	}
+	transposeRuns(rows, cols, 1, data);
+}
@@ -0,0 +1,25 @@
+#pragma once
+
+#include <cstddef>
+
+
+namespace task {
+
+	// dst = src^T, where src is rows x cols and dst is cols x rows, both
+	// row-major with leading dimensions lds and ldd
+	void transpose(size_t rows, size_t cols, const double* src, size_t lds, double* dst, size_t ldd);
+
+	// Transposes an n x n matrix in place
+	void transposeSquare(size_t n, double* data, size_t ld);
+
+	// Transposes a contiguous rows x cols matrix in place, afterwards the
+	// buffer holds the cols x rows result. Allocates nothing: when one side
+	// is a multiple of the other the square blocks go through the tiled
+	// kernel, otherwise single elements follow the cycles of the permutation
+	void transposeInPlace(size_t rows, size_t cols, double* data);
+
+	// Transposes in place a contiguous rows x cols matrix whose elements are
+	// runs of length doubles, moving every run as a whole
+	void transposeRuns(size_t rows, size_t cols, size_t length, double* data);
+
+}  // namespace task
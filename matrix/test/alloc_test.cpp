@@ -0,0 +1,175 @@
+#include <cstdlib>
+#include <iostream>
+#include <new>
+#include <string>
+#include <utility>
+#include "src/lu.h"
+#include "src/matrix.h"
+#include "test/util.h"
+
+
+using task::Matrix;
+
+
+// Every heap allocation of the process, so a test can count what an operation costs
+size_t allocations = 0;
+
+void* operator new(size_t size) {
+    ++allocations;
+    if (void* p = std::malloc(size)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void* operator new[](size_t size) {
+    return operator new(size);
+}
+
+void operator delete(void* p) noexcept {
+    std::free(p);
+}
+
+void operator delete[](void* p) noexcept {
+    std::free(p);
+}
+
+void operator delete(void* p, size_t) noexcept {
+    std::free(p);
+}
+
+void operator delete[](void* p, size_t) noexcept {
+    std::free(p);
+}
+
+
+// Runs the statement and checks how many allocations it made
+#define ASSERT_ALLOCATIONS(statement, expected) \
+    {size_t before = allocations;               \
+    statement;                                  \
+    size_t made = allocations - before;         \
+    if (made != (expected)) FailWithMsg(#statement " made " + std::to_string(made) + " allocations, expected " #expected, __LINE__);}
+
+
+Matrix NaiveProduct(const Matrix& a, const Matrix& b) {
+    Matrix res(a.rowsCount, b.columnsCount);
+    for (size_t i = 0; i < a.rowsCount; ++i) {
+        for (size_t j = 0; j < b.columnsCount; ++j) {
+            double sum = 0;
+            for (size_t k = 0; k < a.columnsCount; ++k) {
+                sum += a[i][k] * b[k][j];
+            }
+            res[i][j] = sum;
+        }
+    }
+    return res;
+}
+
+Matrix Scaled(Matrix a, double factor) {
+    a *= factor;
+    return a;
+}
+
+
+int main() {
+
+    {
+        Matrix a = RandomMatrix(10, 10);
+        Matrix b = RandomMatrix(10, 10);
+        Matrix c = RandomMatrix(10, 10);
+
+        ASSERT_ALLOCATIONS(Matrix res = a + b * 2. - c, 1)
+        ASSERT_ALLOCATIONS(Matrix res = a + b, 1)
+        ASSERT_ALLOCATIONS(Matrix res = a * b, 1)
+        ASSERT_ALLOCATIONS(Matrix res = (a + b) * c, 2)
+        ASSERT_ALLOCATIONS(Matrix res = a.transposed(), 1)
+        ASSERT_ALLOCATIONS(a.transpose(), 0)
+        Matrix tall = RandomMatrix(30, 10);
+        Matrix odd = RandomMatrix(7, 10);
+        ASSERT_ALLOCATIONS(tall.transpose(), 0)
+        ASSERT_ALLOCATIONS(odd.transpose(), 0)
+        ASSERT_ALLOCATIONS(a *= b, 1)
+        ASSERT_ALLOCATIONS(a *= 3., 0)
+        ASSERT_ALLOCATIONS(a += b, 0)
+        ASSERT_ALLOCATIONS(a -= b - c, 0)
+        ASSERT_ALLOCATIONS(Matrix res = a.inverse(), 3)
+    }
+
+    {
+        // Moves hand the buffer over
+        Matrix a = RandomMatrix(10, 10);
+        Matrix copy = a;
+        const double* buffer = a.data();
+
+        ASSERT_ALLOCATIONS(Matrix moved = std::move(a), 0)
+        ASSERT_TRUE_MSG(a.rowsCount == 0 && a.columnsCount == 0, "A moved-from matrix is empty")
+
+        Matrix b = RandomMatrix(10, 10);
+        buffer = copy.data();
+        ASSERT_ALLOCATIONS(b = std::move(copy), 0)
+        ASSERT_TRUE_MSG(b.data() == buffer && copy.rowsCount == 0, "Move assignment takes the buffer")
+
+        Matrix res;
+        ASSERT_ALLOCATIONS(res = Scaled(std::move(b), 2.), 0)
+        ASSERT_ALLOCATIONS(a = res, 1)
+        ASSERT_TRUE_MSG(a == res, "A moved-from matrix can be assigned to")
+    }
+
+    {
+        // Assignments keep the buffer while it is big enough
+        Matrix small = RandomMatrix(4, 6);
+        Matrix large = RandomMatrix(10, 10);
+        Matrix res(10, 10);
+
+        ASSERT_ALLOCATIONS(res = small, 0)
+        ASSERT_TRUE_MSG(res == small && res.isContiguous(), "Assigning a smaller matrix")
+        ASSERT_ALLOCATIONS(res = large, 0)
+        ASSERT_TRUE_MSG(res == large, "Assigning a matrix of the original size")
+        ASSERT_ALLOCATIONS(res = small + small, 0)
+        ASSERT_TRUE_MSG(res == small * 2., "Assigning a smaller expression")
+        ASSERT_ALLOCATIONS(res = large - large, 0)
+        ASSERT_ALLOCATIONS(res = RandomMatrix(11, 10), 1)
+        ASSERT_ALLOCATIONS(res.resize(3, 3), 0)
+    }
+
+    {
+        Matrix a = RandomMatrix(7, 5);
+        Matrix b = RandomMatrix(5, 9);
+        Matrix c = RandomMatrix(7, 5);
+        Matrix dst(9, 9);
+
+        ASSERT_ALLOCATIONS(a.mulInto(b, dst), 0)
+        ASSERT_TRUE_MSG(dst == NaiveProduct(a, b), "mulInto()")
+        ASSERT_ALLOCATIONS(a.addInto(c, dst), 0)
+        ASSERT_TRUE_MSG(dst == a + c, "addInto()")
+        ASSERT_ALLOCATIONS(a.subInto(c, dst), 0)
+        ASSERT_TRUE_MSG(dst == a - c, "subInto()")
+
+        Matrix small(2, 2);
+        ASSERT_ALLOCATIONS(a.mulInto(b, small), 1)
+        ASSERT_TRUE_MSG(small == NaiveProduct(a, b), "mulInto() a matrix too small for the product")
+
+        // The destination may be an operand
+        Matrix expected = a + c;
+        ASSERT_ALLOCATIONS(a.addInto(c, c), 0)
+        ASSERT_TRUE_MSG(c == expected, "addInto() the right operand")
+        expected = NaiveProduct(a, b);
+        a.mulInto(b, a);
+        ASSERT_TRUE_MSG(a == expected, "mulInto() the left operand")
+    }
+
+    {
+        // Products past the size gemm packs at, after it has got its scratch space
+        Matrix a = RandomMatrix(100, 80);
+        Matrix b = RandomMatrix(80, 120);
+        Matrix dst(100, 120);
+        a.mulInto(b, dst);
+
+        ASSERT_ALLOCATIONS(a.mulInto(b, dst), 0)
+        ASSERT_TRUE_MSG(dst == NaiveProduct(a, b), "mulInto() with packing")
+        ASSERT_ALLOCATIONS(Matrix res = a * b, 1)
+    }
+
+    std::cout << "All allocation tests passed!" << std::endl;
+    return 0;
+}
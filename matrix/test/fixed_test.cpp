@@ -0,0 +1,132 @@
+#include <cmath>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include "src/fixed_matrix.h"
+#include "src/matrix.h"
+#include "test/util.h"
+
+
+using task::FixedMatrix;
+using task::Matrix;
+using task::Matrix2;
+using task::Matrix3;
+using task::Matrix4;
+
+
+template<size_t Rows, size_t Cols>
+FixedMatrix<double, Rows, Cols> RandomFixed() {
+    static std::mt19937 rand(42);
+    std::uniform_real_distribution<double> dist{-10., 10.};
+
+    FixedMatrix<double, Rows, Cols> res;
+    for (size_t row = 0; row < Rows; ++row) {
+        for (size_t col = 0; col < Cols; ++col) {
+            res[row][col] = dist(rand);
+        }
+    }
+    return res;
+}
+
+// Checks det() and inverse() of a fixed matrix against the LU of the dynamic one
+template<size_t N>
+void CheckAgainstDynamic() {
+    for (int round = 0; round < 20; ++round) {
+        auto a = RandomFixed<N, N>();
+        Matrix dynamic = a;
+        double det = dynamic.det();
+        ASSERT_TRUE_MSG(std::abs(a.det() - det) <= 1e-9 * std::max(1., std::abs(det)),
+                        "det() of a " + std::to_string(N) + "x" + std::to_string(N) + " matrix")
+        ASSERT_TRUE_MSG(a * a.inverse() == (FixedMatrix<double, N, N>::identity()),
+                        "inverse() of a " + std::to_string(N) + "x" + std::to_string(N) + " matrix")
+        ASSERT_TRUE_MSG(dynamic.inverse() == a.inverse(), "inverse() agrees with Matrix::inverse()")
+    }
+}
+
+
+// Evaluated by the compiler
+constexpr Matrix2 ROTATION(0., -1., 1., 0.);
+static_assert((ROTATION * ROTATION).trace() == -2., "constexpr product");
+static_assert(ROTATION.det() == 1., "constexpr det()");
+static_assert(ROTATION.transposed().get<0, 1>() == 1., "constexpr transposed()");
+static_assert(Matrix3::rowsCount == 3 && FixedMatrix<double, 2, 5>::columnsCount == 5, "Dimensions are constants");
+
+
+int main() {
+
+    {
+        Matrix2 a(1, 2, 3, 4);
+        Matrix2 b(5, 6, 7, 8);
+
+        ASSERT_TRUE_MSG(a + b == Matrix2(6, 8, 10, 12), "operator+")
+        ASSERT_TRUE_MSG(a - b == Matrix2(-4, -4, -4, -4), "operator-")
+        ASSERT_TRUE_MSG(-a == Matrix2(-1, -2, -3, -4), "Unary operator-")
+        ASSERT_TRUE_MSG(a * b == Matrix2(19, 22, 43, 50), "operator*")
+        ASSERT_TRUE_MSG(2 * a == a * 2. && a * 2. == Matrix2(2, 4, 6, 8), "Scaling")
+        ASSERT_TRUE_MSG(a != b, "operator!=")
+        ASSERT_TRUE_MSG(a.det() == -2., "det()")
+        ASSERT_TRUE_MSG(a.inverse() == Matrix2(-2, 1, 1.5, -.5), "inverse()")
+        ASSERT_TRUE_MSG(a.trace() == 5., "trace()")
+        a *= b;
+        ASSERT_TRUE_MSG(a == Matrix2(19, 22, 43, 50), "operator*=")
+    }
+
+    {
+        // Products of rectangular matrices have the size in their type
+        FixedMatrix<double, 2, 3> a(1, 2, 3, 4, 5, 6);
+        FixedMatrix<double, 3, 1> x(1, 0, -1);
+        FixedMatrix<double, 2, 1> y = a * x;
+        ASSERT_TRUE_MSG(y == (FixedMatrix<double, 2, 1>(-2, -2)), "Matrix-vector product")
+        ASSERT_TRUE_MSG(a.transposed() == (FixedMatrix<double, 3, 2>(1, 4, 2, 5, 3, 6)), "transposed()")
+        ASSERT_TRUE_MSG(a * a.transposed() == Matrix2(14, 32, 32, 77), "Product with the transpose")
+
+        std::stringstream output;
+        output << a;
+        ASSERT_TRUE_MSG(output.str() == "1 2 3\n4 5 6\n", "operator<<")
+    }
+
+    CheckAgainstDynamic<1>();
+    CheckAgainstDynamic<2>();
+    CheckAgainstDynamic<3>();
+    CheckAgainstDynamic<4>();
+    CheckAgainstDynamic<5>();
+    CheckAgainstDynamic<7>();
+
+    {
+        // Row exchanges in the elimination used above 4 x 4
+        FixedMatrix<double, 5, 5> cycle;
+        for (size_t i = 0; i < 5; ++i) {
+            cycle[i][(i + 1) % 5] = i + 1.;
+        }
+        ASSERT_TRUE_MSG(std::abs(cycle.det() - 120) < 1e-12, "det() of a cyclic permutation")
+        ASSERT_TRUE_MSG(cycle * cycle.inverse() == (FixedMatrix<double, 5, 5>::identity()), "inverse() with pivoting")
+    }
+
+    {
+        Matrix3 singular(1, 2, 3, 2, 4, 6, 1, 0, 1);
+        ASSERT_TRUE_MSG(singular.det() == 0., "det() of a singular matrix")
+        ASSERT_EXCEPTION_MSG(singular.inverse(), task::SingularMatrixException, "inverse() of a singular matrix")
+        ASSERT_EXCEPTION_MSG(Matrix2(1, 2, 2, 4).inverse(), task::SingularMatrixException, "inverse() of a singular 2x2 matrix")
+        ASSERT_EXCEPTION_MSG((FixedMatrix<double, 6, 6>().inverse()), task::SingularMatrixException, "inverse() of a zero matrix")
+    }
+
+    {
+        // Mixing with the dynamic matrix
+        auto a = RandomFixed<4, 4>();
+        Matrix dynamic(4, 4);
+
+        Matrix sum = a + dynamic;
+        ASSERT_TRUE_MSG(sum == a + Matrix4::identity(), "Element-wise expression of fixed and dynamic matrices")
+        ASSERT_TRUE_MSG(Matrix(a * 2. - dynamic) == a * 2. - Matrix4::identity(), "Fixed matrix on the left")
+        ASSERT_TRUE_MSG(Matrix4(dynamic * a) == a, "Product with a dynamic matrix")
+        ASSERT_TRUE_MSG(Matrix4(Matrix(a)) == a, "Round trip through Matrix")
+        ASSERT_TRUE_MSG(dynamic == Matrix4::identity(), "Comparison with a dynamic matrix")
+
+        ASSERT_EXCEPTION_MSG(Matrix3(dynamic), task::SizeMismatchException, "Conversion from a matrix of another size")
+        ASSERT_EXCEPTION_MSG(Matrix(Matrix3() + dynamic), task::SizeMismatchException, "Expression of mismatched sizes")
+    }
+
+    std::cout << "All fixed-size matrix tests passed!" << std::endl;
+    return 0;
+}
@@ -0,0 +1,84 @@
+#include <iostream>
+#include <string>
+#include "src/gemm.h"
+#include "src/matrix.h"
+#include "test/util.h"
+
+
+using task::Matrix;
+
+
+// C + alpha * A * B with the textbook loop
+Matrix NaiveGemm(const Matrix& a, const Matrix& b, const Matrix& c, double alpha) {
+    Matrix res = c;
+    for (size_t i = 0; i < a.rowsCount; ++i) {
+        for (size_t j = 0; j < b.columnsCount; ++j) {
+            double sum = 0;
+            for (size_t p = 0; p < a.columnsCount; ++p) {
+                sum += a[i][p] * b[p][j];
+            }
+            res[i][j] += alpha * sum;
+        }
+    }
+    return res;
+}
+
+std::string Shape(size_t m, size_t n, size_t k) {
+    return std::to_string(m) + "x" + std::to_string(n) + "x" + std::to_string(k);
+}
+
+
+int main() {
+
+    // m x n x k, none a multiple of the register tile MR x NR = 4 x 8 or of
+    // the cache blocks KC = 256, MC = 96, NC = 2048, so every loop has a tail
+    const size_t SHAPES[][3] = {
+        {33, 33, 33},      // Just past the naive path
+        {101, 259, 77},
+        {97, 33, 2050},    // Several KC panels
+        {203, 17, 301},    // Several MC blocks
+        {5, 2100, 40},     // Several NC panels
+        {1, 1000, 1000},
+        {1000, 1, 1000},
+    };
+
+    for (const auto& shape : SHAPES) {
+        size_t m = shape[0], n = shape[1], k = shape[2];
+        Matrix a = RandomMatrix(m, k);
+        Matrix b = RandomMatrix(k, n);
+        Matrix c = RandomMatrix(m, n);
+
+        Matrix res = c;
+        task::gemm(m, n, k, a.data(), a.getStride(), b.data(), b.getStride(), res.data(), res.getStride());
+        ASSERT_TRUE_MSG(res == NaiveGemm(a, b, c, 1.), "C += A * B for " + Shape(m, n, k))
+
+        res = c;
+        task::gemm(m, n, k, a.data(), a.getStride(), b.data(), b.getStride(), res.data(), res.getStride(), -.5);
+        ASSERT_TRUE_MSG(res == NaiveGemm(a, b, c, -.5), "C += alpha * A * B for " + Shape(m, n, k))
+
+        ASSERT_TRUE_MSG(a * b == NaiveGemm(a, b, Matrix(m, n) * 0., 1.), "operator* for " + Shape(m, n, k))
+    }
+
+    {
+        // Operands and result inside bigger matrices, so every leading
+        // dimension differs from the width
+        Matrix a = RandomMatrix(130, 90);
+        Matrix b = RandomMatrix(300, 120);
+        Matrix c = RandomMatrix(110, 140);
+        Matrix res = c;
+        task::gemm(101, 97, 77, a[3] + 5, a.getStride(), b[200] + 11, b.getStride(), res[7] + 13, res.getStride());
+
+        Matrix expected = c;
+        for (size_t i = 0; i < 101; ++i) {
+            for (size_t j = 0; j < 97; ++j) {
+                for (size_t p = 0; p < 77; ++p) {
+                    expected[7 + i][13 + j] += a[3 + i][5 + p] * b[200 + p][11 + j];
+                }
+            }
+        }
+        ASSERT_TRUE_MSG(res == expected, "Leading dimensions larger than the widths")
+    }
+
+    std::cout << "All GEMM tests passed!" << std::endl;
+    return 0;
+}
@@ -0,0 +1,122 @@
+#include <iostream>
+#include <string>
+#include <cmath>
+#include "src/lu.h"
+#include "src/matrix.h"
+#include "test/util.h"
+
+
+using task::LUDecomposition;
+using task::Matrix;
+
+
+Matrix FromRows(size_t rows, size_t cols, std::initializer_list<double> values) {
+    Matrix res(rows, cols);
+    auto value = values.begin();
+    for (size_t row = 0; row < rows; ++row) {
+        for (size_t col = 0; col < cols; ++col) {
+            res[row][col] = *value++;
+        }
+    }
+    return res;
+}
+
+double MaxDifference(const Matrix& a, const Matrix& b) {
+    double res = 0;
+    for (size_t row = 0; row < a.rowsCount; ++row) {
+        for (size_t col = 0; col < a.columnsCount; ++col) {
+            res = std::max(res, std::abs(a[row][col] - b[row][col]));
+        }
+    }
+    return res;
+}
+
+bool RelativelyClose(double value, double expected, double tolerance) {
+    return std::abs(value - expected) <= tolerance * std::abs(expected);
+}
+
+
+int main() {
+
+    {
+        // Discrete Laplacian, det = n + 1 and a closed-form inverse
+        auto mat = FromRows(3, 3, {2, -1, 0, -1, 2, -1, 0, -1, 2});
+        auto inverse = FromRows(3, 3, {.75, .5, .25, .5, 1, .5, .25, .5, .75});
+
+        ASSERT_TRUE_MSG(std::abs(mat.det() - 4) < 1e-12, "det() of a tridiagonal matrix")
+        ASSERT_TRUE_MSG(MaxDifference(mat.inverse(), inverse) < 1e-12, "inverse() of a tridiagonal matrix")
+
+        auto x = mat.solve(FromRows(3, 1, {1, 0, 1}));
+        ASSERT_TRUE_MSG(MaxDifference(x, FromRows(3, 1, {1, 1, 1})) < 1e-12, "solve()")
+    }
+
+    {
+        // Needs row exchanges, each one flips the sign
+        auto swap = FromRows(2, 2, {0, 1, 1, 0});
+        ASSERT_TRUE_MSG(swap.det() == -1., "det() with one row exchange")
+
+        auto cycle = FromRows(3, 3, {0, 0, 3, 2, 0, 0, 0, 5, 0});
+        ASSERT_TRUE_MSG(std::abs(cycle.det() - 30) < 1e-12, "det() of a cyclic permutation")
+        ASSERT_TRUE_MSG(MaxDifference(cycle * cycle.inverse(), Matrix(3, 3)) < 1e-12, "inverse() with pivoting")
+    }
+
+    {
+        // Hilbert matrix, det(H5) = 1 / 266716800000
+        Matrix hilbert(5, 5);
+        for (size_t row = 0; row < 5; ++row) {
+            for (size_t col = 0; col < 5; ++col) {
+                hilbert[row][col] = 1. / (row + col + 1);
+            }
+        }
+        ASSERT_TRUE_MSG(RelativelyClose(hilbert.det(), 1. / 266716800000., 1e-9), "det() of an ill-conditioned matrix")
+        ASSERT_TRUE_MSG(RelativelyClose(hilbert.inverse()[4][4], 44100., 1e-6), "inverse() of an ill-conditioned matrix")
+    }
+
+    {
+        auto singular = FromRows(3, 3, {1, 2, 3, 2, 4, 6, 1, 0, 1});
+        LUDecomposition lu(singular);
+        ASSERT_TRUE_MSG(lu.isSingular(), "isSingular()")
+        ASSERT_TRUE_MSG(lu.det() == 0., "det() of a singular matrix")
+        ASSERT_EXCEPTION_MSG(lu.inverse(), task::SingularMatrixException, "inverse() of a singular matrix")
+        ASSERT_EXCEPTION_MSG(lu.solve(Matrix(3, 1)), task::SingularMatrixException, "solve() with a singular matrix")
+
+        ASSERT_EXCEPTION_MSG(LUDecomposition(Matrix(2, 3)), task::SizeMismatchException, "Non-square matrix")
+        ASSERT_EXCEPTION_MSG(lu.solve(Matrix(2, 1)), task::SizeMismatchException, "solve() size mismatch")
+    }
+
+    // Sizes spanning several panels, including ones not a multiple of the panel
+    for (size_t n : {1, 63, 64, 65, 200, 333}) {
+        // D + u v^T has det(D) (1 + v^T D^-1 u), reversing its rows flips the
+        // sign floor(n / 2) times and forces pivoting at every step
+        Matrix u = RandomMatrix(n, 1) * .01;
+        Matrix v = RandomMatrix(n, 1) * .01;
+        Matrix product = u * v.transposed();
+        double det = n / 2 % 2 == 0 ? 1 : -1;
+        double lemma = 1;
+        for (size_t row = 0; row < n; ++row) {
+            double diagonal = 1 + row % 3 * .5;
+            product[row][row] += diagonal;
+            det *= diagonal;
+            lemma += v[row][0] * u[row][0] / diagonal;
+        }
+        det *= lemma;
+
+        Matrix mat(n, n);
+        for (size_t row = 0; row < n; ++row) {
+            for (size_t col = 0; col < n; ++col) {
+                mat[row][col] = product[n - 1 - row][col];
+            }
+        }
+
+        LUDecomposition lu(mat);
+        ASSERT_TRUE_MSG(RelativelyClose(lu.det(), det, 1e-10), "det() of size " + std::to_string(n))
+
+        Matrix b = RandomMatrix(n, 3);
+        Matrix x = lu.solve(b);
+        ASSERT_TRUE_MSG(MaxDifference(mat * x, b) < 1e-10, "solve() residual of size " + std::to_string(n))
+        ASSERT_TRUE_MSG(MaxDifference(mat * lu.inverse(), Matrix(n, n)) < 1e-10, "inverse() of size " + std::to_string(n))
+    }
+
+    std::cout << "All LU tests passed!" << std::endl;
+    return 0;
+}
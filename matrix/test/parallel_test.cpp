@@ -0,0 +1,105 @@
+#include <algorithm>
+#include <atomic>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "src/matrix.h"
+#include "src/parallel.h"
+#include "test/util.h"
+
+
+using task::Matrix;
+
+
+// Everything the pool runs, computed on the current number of threads
+struct Results {
+    Matrix square;
+    Matrix tall;
+    Matrix wide;
+    Matrix sum;
+    Matrix difference;
+    Matrix scaled;
+    bool equal;
+    bool unequal;
+};
+
+Results Compute(const Matrix& a, const Matrix& b, const Matrix& c, const Matrix& x, const Matrix& y) {
+    Results res;
+    res.square = a * b;
+    res.tall = c * a;
+    res.wide = a * c.transposed();
+    res.sum = x;
+    res.sum += y;
+    res.difference = x;
+    res.difference -= y;
+    res.scaled = x;
+    res.scaled *= -0.75;
+    res.equal = x == Matrix(x);
+    Matrix changed = x;
+    changed[x.rowsCount - 1][x.columnsCount - 1] += 1.;
+    res.unequal = x == changed;
+    return res;
+}
+
+
+int main() {
+    const size_t THREAD_COUNTS[] = {1, 3, 4};
+
+    for (size_t threads : THREAD_COUNTS) {
+        task::parallel::setThreadCount(threads);
+        ASSERT_TRUE_MSG(task::parallel::threadCount() == threads, "setThreadCount()")
+
+        // Every index is visited once, in blocks of grain that do not depend on the thread count
+        const size_t COUNT = 100003;
+        const size_t GRAIN = 1000;
+        std::vector<std::atomic<int>> visits(COUNT);
+        std::atomic<size_t> blocks{0};
+        std::atomic<bool> aligned{true};
+        task::parallel::forRange(COUNT, GRAIN, [&](size_t begin, size_t end) {
+            if (begin % GRAIN != 0 || end != std::min(begin + GRAIN, COUNT)) {
+                aligned = false;
+            }
+            for (size_t i = begin; i < end; ++i) {
+                ++visits[i];
+            }
+            ++blocks;
+        });
+        ASSERT_TRUE_MSG(std::all_of(visits.begin(), visits.end(), [](const std::atomic<int>& v) { return v == 1; }),
+                        "forRange() visits every index once on " + std::to_string(threads) + " threads")
+        ASSERT_TRUE_MSG(aligned && blocks == (COUNT + GRAIN - 1) / GRAIN, "forRange() blocks on " + std::to_string(threads) + " threads")
+
+        std::atomic<size_t> covered{0};
+        task::parallel::runBlocks(10, 3, [&](size_t begin, size_t end) { covered += end - begin; });
+        ASSERT_TRUE_MSG(covered == 10, "runBlocks() on " + std::to_string(threads) + " threads")
+    }
+
+    {
+        // Big enough for the GEMM tile split and for sweeps past SWEEP_GRAIN,
+        // with odd sizes so tiles and blocks are uneven
+        Matrix a = RandomMatrix(301, 301);
+        Matrix b = RandomMatrix(301, 301);
+        Matrix c = RandomMatrix(517, 301);
+        Matrix x = RandomMatrix(487, 293);
+        Matrix y = RandomMatrix(487, 293);
+
+        task::parallel::setThreadCount(1);
+        Results serial = Compute(a, b, c, x, y);
+        ASSERT_TRUE_MSG(serial.equal && !serial.unequal, "operator== on 1 thread")
+
+        for (size_t threads : THREAD_COUNTS) {
+            task::parallel::setThreadCount(threads);
+            Results parallel = Compute(a, b, c, x, y);
+            std::string on = " on " + std::to_string(threads) + " threads";
+            ASSERT_TRUE_MSG(Identical(parallel.square, serial.square), "Square product" + on)
+            ASSERT_TRUE_MSG(Identical(parallel.tall, serial.tall), "Tall product" + on)
+            ASSERT_TRUE_MSG(Identical(parallel.wide, serial.wide), "Wide product" + on)
+            ASSERT_TRUE_MSG(Identical(parallel.sum, serial.sum), "+=" + on)
+            ASSERT_TRUE_MSG(Identical(parallel.difference, serial.difference), "-=" + on)
+            ASSERT_TRUE_MSG(Identical(parallel.scaled, serial.scaled), "*=" + on)
+            ASSERT_TRUE_MSG(parallel.equal && !parallel.unequal, "operator==" + on)
+        }
+    }
+
+    std::cout << "All parallel tests passed!" << std::endl;
+    return 0;
+}
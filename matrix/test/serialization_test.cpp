@@ -0,0 +1,144 @@
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <system_error>
+#include <utility>
+#include <unistd.h>
+#include "src/matrix.h"
+#include "src/serialization.h"
+#include "test/util.h"
+
+
+using task::FormatException;
+using task::MappedMatrix;
+using task::Matrix;
+
+
+std::string Serialized(const Matrix& matrix) {
+    std::stringstream stream;
+    task::writeBinary(stream, matrix);
+    return stream.str();
+}
+
+// The same file written on a machine of the other byte order
+std::string ByteSwapped(std::string bytes) {
+    std::reverse(bytes.begin() + 8, bytes.begin() + 16);
+    std::reverse(bytes.begin() + 16, bytes.begin() + 24);
+    for (size_t offset = 32; offset < bytes.size(); offset += 8) {
+        std::reverse(bytes.begin() + offset, bytes.begin() + offset + 8);
+    }
+    bytes[6] = bytes[6] == 1 ? 2 : 1;
+    return bytes;
+}
+
+Matrix Deserialized(const std::string& bytes) {
+    std::stringstream stream(bytes);
+    return task::readBinary(stream);
+}
+
+// Stream that cannot seek, like a pipe, so the remaining length is unknown
+class PipeBuffer : public std::streambuf {
+public:
+    explicit PipeBuffer(std::string bytes) : bytes(std::move(bytes)) {
+        setg(&this->bytes[0], &this->bytes[0], &this->bytes[0] + this->bytes.size());
+    }
+
+private:
+    std::string bytes;
+};
+
+Matrix DeserializedFromPipe(const std::string& bytes) {
+    PipeBuffer buffer(bytes);
+    std::istream stream(&buffer);
+    return task::readBinary(stream);
+}
+
+// Header claiming a rows x cols matrix, with no elements after it
+std::string HeaderOnly(uint64_t rows, uint64_t cols) {
+    std::string bytes = Serialized(Matrix(1, 1)).substr(0, 32);
+    bytes.replace(8, 8, reinterpret_cast<const char*>(&rows), 8);
+    bytes.replace(16, 8, reinterpret_cast<const char*>(&cols), 8);
+    return bytes;
+}
+
+
+int main() {
+
+    {
+        Matrix a = RandomMatrix(37, 23);
+        std::string bytes = Serialized(a);
+        ASSERT_TRUE_MSG(bytes.size() == 32 + 37 * 23 * sizeof(double), "Header and raw elements")
+        ASSERT_TRUE_MSG(bytes.compare(0, 4, "TMAT") == 0, "Magic")
+        ASSERT_TRUE_MSG(Identical(Deserialized(bytes), a), "Round trip")
+        ASSERT_TRUE_MSG(Identical(Deserialized(ByteSwapped(bytes)), a), "Reading the other byte order")
+
+        // Shrinking the columns leaves the rows at the old stride
+        Matrix strided = a;
+        strided.resize(30, 11);
+        ASSERT_TRUE_MSG(!strided.isContiguous(), "Strided matrix")
+        ASSERT_TRUE_MSG(Identical(Deserialized(Serialized(strided)), strided), "Round trip of a strided matrix")
+
+        ASSERT_TRUE_MSG(Identical(Deserialized(Serialized(Matrix(0, 5))), Matrix(0, 5)), "Round trip of an empty matrix")
+    }
+
+    {
+        std::string bytes = Serialized(RandomMatrix(4, 4));
+        ASSERT_EXCEPTION_MSG(Deserialized(""), FormatException, "No header")
+        ASSERT_EXCEPTION_MSG(Deserialized("TMAX" + bytes.substr(4)), FormatException, "Wrong magic")
+        ASSERT_EXCEPTION_MSG(Deserialized(bytes.substr(0, 4) + '\x07' + bytes.substr(5)), FormatException, "Unknown version")
+        ASSERT_EXCEPTION_MSG(Deserialized(bytes.substr(0, bytes.size() - 1)), FormatException, "Elements cut short")
+        ASSERT_EXCEPTION_MSG(DeserializedFromPipe(bytes.substr(0, bytes.size() - 1)), FormatException, "Elements cut short in a pipe")
+
+        // Petabytes in the header would fail to allocate, or take the memory, if read before checking the data
+        ASSERT_EXCEPTION_MSG(Deserialized(HeaderOnly(uint64_t(1) << 30, uint64_t(1) << 20)), FormatException, "Huge header without elements")
+        ASSERT_EXCEPTION_MSG(DeserializedFromPipe(HeaderOnly(uint64_t(1) << 30, uint64_t(1) << 20)), FormatException, "Huge header without elements in a pipe")
+        ASSERT_EXCEPTION_MSG(Deserialized(HeaderOnly(uint64_t(1) << 40, uint64_t(1) << 40)), FormatException, "Header whose size overflows")
+    }
+
+    {
+        // More than the step a pipe is read in
+        Matrix a = RandomMatrix(400, 401);
+        std::string bytes = Serialized(a);
+        ASSERT_TRUE_MSG(Identical(DeserializedFromPipe(bytes), a), "Round trip through a pipe")
+        ASSERT_TRUE_MSG(Identical(DeserializedFromPipe(ByteSwapped(bytes)), a), "Other byte order through a pipe")
+
+        // Whatever follows the elements stays in the stream
+        std::stringstream stream(bytes + bytes);
+        ASSERT_TRUE_MSG(Identical(task::readBinary(stream), a) && Identical(task::readBinary(stream), a), "Two matrices in one stream")
+    }
+
+    {
+        std::string path = "/tmp/matrix_serialization_test_" + std::to_string(getpid());
+        Matrix a = RandomMatrix(50, 70);
+        task::saveBinary(path, a);
+        ASSERT_TRUE_MSG(Identical(task::loadBinary(path), a), "Round trip through a file")
+
+        {
+            MappedMatrix mapped(path);
+            ASSERT_TRUE_MSG(mapped.rowsCount == 50 && mapped.columnsCount == 70, "Mapped dimensions")
+            ASSERT_TRUE_MSG(mapped.data()[69] == a[0][69] && mapped.valueAt(49, 3) == a[49][3], "Mapped elements")
+            ASSERT_TRUE_MSG(Identical(Matrix(mapped), a), "Conversion of a mapped matrix")
+            ASSERT_TRUE_MSG(Identical(Matrix(mapped + a), a * 2.), "Mapped matrix in an expression")
+
+            MappedMatrix moved = std::move(mapped);
+            ASSERT_TRUE_MSG(moved.valueAt(1, 1) == a[1][1] && mapped.rowsCount == 0, "Moving a mapping")
+        }
+
+        {
+            std::ofstream(path, std::ios::binary) << ByteSwapped(Serialized(a));
+            ASSERT_TRUE_MSG(Identical(task::loadBinary(path), a), "Loading the other byte order")
+            ASSERT_EXCEPTION_MSG(MappedMatrix(path), FormatException, "Mapping the other byte order")
+        }
+
+        std::remove(path.c_str());
+        ASSERT_EXCEPTION_MSG(MappedMatrix(path), std::system_error, "Mapping a missing file")
+        ASSERT_EXCEPTION_MSG(task::loadBinary(path), std::system_error, "Loading a missing file")
+    }
+
+    std::cout << "All serialization tests passed!" << std::endl;
+    return 0;
+}
@@ -0,0 +1,142 @@
+#include <algorithm>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <string>
+#include "src/matrix.h"
+#include "src/simd.h"
+#include "src/sparse.h"
+#include "test/util.h"
+
+
+using task::Matrix;
+using task::simd::Isa;
+
+
+// Heap array of exactly n elements, so AddressSanitizer catches a kernel reading past the end
+std::unique_ptr<double[]> RandomArray(size_t n) {
+    static std::mt19937 rand(7);
+    std::uniform_real_distribution<double> dist{-10., 10.};
+
+    std::unique_ptr<double[]> res(new double[n]);
+    for (size_t i = 0; i < n; ++i) {
+        res[i] = dist(rand);
+    }
+    return res;
+}
+
+bool Equal(const double* a, const double* b, size_t n) {
+    return std::equal(a, a + n, b);
+}
+
+std::string Case(Isa isa, size_t n, size_t offset) {
+    return std::string(task::simd::isaName(isa)) + ", n = " + std::to_string(n) + ", offset " + std::to_string(offset);
+}
+
+
+int main() {
+    const Isa ISAS[] = {Isa::Scalar, Isa::Sse2, Isa::Avx2, Isa::Avx512};
+    // Longest vector is 8 doubles, a few vectors plus every tail length
+    const size_t MAX_LENGTH = 40;
+
+    for (Isa isa : ISAS) {
+        if (isa > task::simd::detectedIsa()) {
+            continue;
+        }
+        task::simd::useIsa(isa);
+        ASSERT_TRUE_MSG(task::simd::activeIsa() == isa, "useIsa()")
+
+        // The offset starts the arrays off the vector alignment
+        for (size_t n = 0; n <= MAX_LENGTH; ++n) {
+            for (size_t offset : {0, 1}) {
+                auto dst = RandomArray(offset + n);
+                auto src = RandomArray(offset + n);
+                double* d = dst.get() + offset;
+                const double* s = src.get() + offset;
+                std::unique_ptr<double[]> expected(new double[n]);
+
+                std::copy(d, d + n, expected.get());
+                for (size_t i = 0; i < n; ++i) {
+                    expected[i] += s[i];
+                }
+                task::simd::add(d, s, n);
+                ASSERT_TRUE_MSG(Equal(d, expected.get(), n), "add(), " + Case(isa, n, offset))
+
+                for (size_t i = 0; i < n; ++i) {
+                    expected[i] -= s[i];
+                }
+                task::simd::sub(d, s, n);
+                ASSERT_TRUE_MSG(Equal(d, expected.get(), n), "sub(), " + Case(isa, n, offset))
+
+                for (size_t i = 0; i < n; ++i) {
+                    expected[i] *= -1.5;
+                }
+                task::simd::scale(d, -1.5, n);
+                ASSERT_TRUE_MSG(Equal(d, expected.get(), n), "scale(), " + Case(isa, n, offset))
+
+                for (size_t i = 0; i < n; ++i) {
+                    expected[i] += 0.3 * s[i];
+                }
+                task::simd::axpy(d, 0.3, s, n);
+                ASSERT_TRUE_MSG(Equal(d, expected.get(), n), "axpy(), " + Case(isa, n, offset))
+
+                // A difference in every position, the tail included, must be seen
+                ASSERT_TRUE_MSG(task::simd::equal(d, expected.get(), n, task::EPS), "equal(), " + Case(isa, n, offset))
+                for (size_t i = 0; i < n; ++i) {
+                    double kept = expected[i];
+                    expected[i] += task::EPS / 2;
+                    ASSERT_TRUE_MSG(task::simd::equal(d, expected.get(), n, task::EPS), "equal() within eps, " + Case(isa, n, offset))
+                    expected[i] = kept - 2 * task::EPS;
+                    ASSERT_TRUE_MSG(!task::simd::equal(d, expected.get(), n, task::EPS), "equal() past eps at " + std::to_string(i) + ", " + Case(isa, n, offset))
+                    expected[i] = kept;
+                }
+            }
+        }
+    }
+
+    {
+        // Whole matrix operations give the same bits on every instruction set.
+        // Odd widths leave a tail in every row
+        Matrix a = RandomMatrix(37, 53);
+        Matrix b = RandomMatrix(37, 53);
+        Matrix c = RandomMatrix(53, 29);
+        Matrix sparse_dense = RandomMatrix(37, 53) * 0.;
+        for (size_t i = 0; i < 37; ++i) {
+            sparse_dense[i][i * 7 % 53] = a[i][0];
+            sparse_dense[i][i * 11 % 53] += b[i][1];
+        }
+        task::SparseMatrix sparse(sparse_dense);
+
+        task::simd::useIsa(Isa::Scalar);
+        Matrix sum = a + b;
+        Matrix difference = a - b;
+        Matrix scaled = a * 1.7;
+        Matrix accumulated = a;
+        accumulated += b;
+        accumulated *= 0.5;
+        Matrix product = a * c;
+        Matrix sparse_product = sparse * c;
+
+        for (Isa isa : ISAS) {
+            if (isa > task::simd::detectedIsa()) {
+                continue;
+            }
+            task::simd::useIsa(isa);
+            std::string name = task::simd::isaName(isa);
+            ASSERT_TRUE_MSG(Identical(Matrix(a + b), sum), "a + b on " + name)
+            ASSERT_TRUE_MSG(Identical(Matrix(a - b), difference), "a - b on " + name)
+            ASSERT_TRUE_MSG(Identical(Matrix(a * 1.7), scaled), "a * factor on " + name)
+            Matrix updated = a;
+            updated += b;
+            updated *= 0.5;
+            ASSERT_TRUE_MSG(Identical(updated, accumulated), "+= and *= on " + name)
+            ASSERT_TRUE_MSG(Identical(a * c, product), "GEMM on " + name)
+            ASSERT_TRUE_MSG(Identical(sparse * c, sparse_product), "Sparse-dense product on " + name)
+            ASSERT_TRUE_MSG(a == a && !(a == b), "operator== on " + name)
+        }
+        task::simd::useIsa(task::simd::detectedIsa());
+    }
+
+    std::cout << "All SIMD tests passed!" << std::endl;
+    return 0;
+}
@@ -0,0 +1,84 @@
+#include <cmath>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+#include "src/matrix.h"
+#include "src/parallel.h"
+#include "src/sparse.h"
+#include "test/util.h"
+
+
+using task::Matrix;
+using task::SparseMatrix;
+using task::Triplet;
+
+
+// Dense matrix with about density * rows * cols nonzeros
+Matrix RandomSparse(size_t rows, size_t cols, double density) {
+    static std::mt19937 rand(7);
+    std::uniform_real_distribution<double> dist{-10., 10.};
+    std::bernoulli_distribution nonzero(density);
+
+    Matrix temp(rows, cols);
+    for (size_t row = 0; row < rows; ++row) {
+        for (size_t col = 0; col < cols; ++col) {
+            temp[row][col] = nonzero(rand) ? dist(rand) : 0.;
+        }
+    }
+    return temp;
+}
+
+
+int main() {
+
+    {
+        SparseMatrix a(3, 4, {{2, 1, 5.}, {0, 3, 1.}, {0, 0, 2.}, {2, 1, -1.}});
+        ASSERT_TRUE_MSG(a.nonZerosCount() == 3, "Duplicate triplets are summed")
+        ASSERT_TRUE_MSG(a.get(2, 1) == 4. && a.get(0, 0) == 2. && a.get(0, 3) == 1., "get() of nonzeros")
+        ASSERT_TRUE_MSG(a.get(1, 1) == 0. && a.get(0, 2) == 0., "get() of zeros")
+        ASSERT_TRUE_MSG((a.getRowStarts() == std::vector<size_t>{0, 2, 2, 3}), "Row starts")
+        ASSERT_TRUE_MSG((a.getColumnIndices() == std::vector<size_t>{0, 3, 1}), "Columns sorted within rows")
+        ASSERT_EXCEPTION_MSG(a.get(3, 0), task::OutOfBoundsException, "get() out of bounds")
+        ASSERT_EXCEPTION_MSG(SparseMatrix(2, 2, {{0, 2, 1.}}), task::OutOfBoundsException, "Triplet out of bounds")
+
+        ASSERT_TRUE_MSG(SparseMatrix(5, 5).toDense() == Matrix(5, 5) * 0., "An empty sparse matrix is zero")
+        ASSERT_TRUE_MSG(SparseMatrix(Matrix(4, 4)).nonZerosCount() == 4, "Only nonzeros are kept")
+    }
+
+    for (size_t threads : {1, 3}) {
+        task::parallel::setThreadCount(threads);
+
+        // Large enough for every kernel to split its rows into several blocks
+        Matrix dense = RandomSparse(4000, 1000, .02);
+        SparseMatrix a(dense);
+        ASSERT_TRUE_MSG(a.toDense() == dense, "Round trip through SparseMatrix")
+        ASSERT_TRUE_MSG(a.transposed().toDense() == dense.transposed(), "transposed()")
+        ASSERT_TRUE_MSG(a.transposed().transposed().getColumnIndices() == a.getColumnIndices(), "Transposing twice")
+
+        Matrix x = RandomMatrix(1000, 1);
+        ASSERT_TRUE_MSG(a * x == dense * x, "Sparse matrix-vector product")
+        std::vector<double> y(4000);
+        a.multiply(x.data(), y.data());
+        ASSERT_TRUE_MSG(std::abs(y[17] - (dense * x)[17][0]) < 1e-9, "multiply()")
+
+        Matrix b = RandomMatrix(1000, 30);
+        ASSERT_TRUE_MSG(a * b == dense * b, "Sparse-dense product")
+        Matrix c = RandomMatrix(40, 4000);
+        ASSERT_TRUE_MSG(c * a == c * dense, "Dense-sparse product")
+
+        Matrix other = RandomSparse(1000, 50, .05);
+        SparseMatrix product = a * SparseMatrix(other);
+        ASSERT_TRUE_MSG(product.toDense() == dense * other, "Sparse-sparse product")
+        ASSERT_TRUE_MSG(product.nonZerosCount() < 4000 * 50, "The product stays sparse")
+        // Accumulators kept by the threads from the product above are reused
+        Matrix narrow = RandomSparse(1000, 7, .3);
+        ASSERT_TRUE_MSG((a * SparseMatrix(narrow)).toDense() == dense * narrow, "Sparse-sparse products of another width")
+
+        ASSERT_EXCEPTION_MSG(a * RandomMatrix(4000, 2), task::SizeMismatchException, "Sparse-dense size mismatch")
+        ASSERT_EXCEPTION_MSG(a * a, task::SizeMismatchException, "Sparse-sparse size mismatch")
+    }
+
+    std::cout << "All sparse matrix tests passed!" << std::endl;
+    return 0;
+}
@@ -0,0 +1,83 @@
+#include <iostream>
+#include <string>
+#include "src/matrix.h"
+#include "src/parallel.h"
+#include "src/transpose.h"
+#include "test/util.h"
+
+
+using task::Matrix;
+
+
+// Transpose made element by element
+Matrix Transposed(const Matrix& a) {
+    Matrix res(a.columnsCount, a.rowsCount);
+    for (size_t i = 0; i < a.rowsCount; ++i) {
+        for (size_t j = 0; j < a.columnsCount; ++j) {
+            res[j][i] = a[i][j];
+        }
+    }
+    return res;
+}
+
+std::string Shape(size_t rows, size_t cols) {
+    return std::to_string(rows) + "x" + std::to_string(cols);
+}
+
+
+int main() {
+
+    // Sizes off the 16x16 tile, single rows and columns, shapes where one
+    // side is a multiple of the other and shapes where neither is
+    const size_t SHAPES[][2] = {
+        {17, 17}, {257, 257}, {17, 33}, {33, 17}, {257, 129}, {129, 257},
+        {1, 500}, {500, 1}, {300, 100}, {100, 300}, {64, 16}, {16, 64},
+        {2, 3}, {37, 1003},
+    };
+
+    for (size_t threads : {1, 3}) {
+        task::parallel::setThreadCount(threads);
+        std::string on = " on " + std::to_string(threads) + " threads";
+
+        for (const auto& shape : SHAPES) {
+            size_t rows = shape[0], cols = shape[1];
+            Matrix a = RandomMatrix(rows, cols);
+            Matrix expected = Transposed(a);
+
+            ASSERT_TRUE_MSG(a.transposed() == expected, "transposed() of " + Shape(rows, cols) + on)
+
+            Matrix b = a;
+            b.transpose();
+            ASSERT_TRUE_MSG(b.rowsCount == cols && b.columnsCount == rows, "Dimensions after transpose() of " + Shape(rows, cols) + on)
+            ASSERT_TRUE_MSG(b == expected, "transpose() of " + Shape(rows, cols) + on)
+            b.transpose();
+            ASSERT_TRUE_MSG(b == a, "transpose() twice of " + Shape(rows, cols) + on)
+
+            // Rows keep the old stride after shrinking the columns
+            Matrix strided = RandomMatrix(rows + 3, cols + 5);
+            strided.resize(rows, cols);
+            Matrix strided_expected = Transposed(strided);
+            strided.transpose();
+            ASSERT_TRUE_MSG(strided == strided_expected, "transpose() of a strided " + Shape(rows, cols) + on)
+        }
+
+        {
+            // Out of place between blocks of bigger matrices
+            Matrix src = RandomMatrix(300, 200);
+            Matrix dst = RandomMatrix(250, 320);
+            Matrix kept = dst;
+            task::transpose(257, 129, src[5] + 7, src.getStride(), dst[3] + 11, dst.getStride());
+            bool ok = true;
+            for (size_t i = 0; i < 250; ++i) {
+                for (size_t j = 0; j < 320; ++j) {
+                    bool inside = i >= 3 && i < 3 + 129 && j >= 11 && j < 11 + 257;
+                    ok = ok && dst[i][j] == (inside ? src[5 + j - 11][7 + i - 3] : kept[i][j]);
+                }
+            }
+            ASSERT_TRUE_MSG(ok, "transpose() between leading dimensions" + on)
+        }
+    }
+
+    std::cout << "All transpose tests passed!" << std::endl;
+    return 0;
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <string>
+#include "src/matrix.h"
+
+
+inline void FailWithMsg(const std::string& msg, int line) {
+    std::cerr << "Test failed!\n";
+    std::cerr << "[Line " << line << "] "  << msg << std::endl;
+    std::exit(EXIT_FAILURE);
+}
+
+#define ASSERT_TRUE_MSG(cond, msg) \
+    if (!(cond)) {FailWithMsg(msg, __LINE__);};
+
+#define ASSERT_EXCEPTION_MSG(cond, ex, msg) \
+    {bool ok = false;                       \
+    try {(cond);} catch (const ex&) {ok = true;} catch (...) {} \
+    if (!ok) FailWithMsg(msg, __LINE__);}
+
+
+// Elements uniform in [-10, 10), the same sequence in every run
+inline task::Matrix RandomMatrix(size_t rows, size_t cols) {
+    static std::mt19937 rand(42);
+    std::uniform_real_distribution<double> dist{-10., 10.};
+
+    task::Matrix temp(rows, cols);
+    for (size_t row = 0; row < rows; ++row) {
+        for (size_t col = 0; col < cols; ++col) {
+            temp[row][col] = dist(rand);
+        }
+    }
+    return temp;
+}
+
+// Exact comparison, operator== lets elements differ by EPS
+inline bool Identical(const task::Matrix& a, const task::Matrix& b) {
+    if (a.rowsCount != b.rowsCount || a.columnsCount != b.columnsCount) {
+        return false;
+    }
+    for (size_t row = 0; row < a.rowsCount; ++row) {
+        if (!std::equal(a[row], a[row] + a.columnsCount, b[row])) {
+            return false;
+        }
+    }
+    return true;
+}
@@ -0,0 +1,151 @@
+#include <iostream>
+#include <string>
+#include "src/matrix.h"
+#include "src/parallel.h"
+#include "test/util.h"
+
+
+using task::ConstMatrixView;
+using task::Matrix;
+using task::MatrixView;
+
+
+// Copy of a block made element by element
+Matrix Block(const Matrix& a, size_t row, size_t col, size_t rows, size_t cols) {
+    Matrix res(rows, cols);
+    for (size_t i = 0; i < rows; ++i) {
+        for (size_t j = 0; j < cols; ++j) {
+            res[i][j] = a[row + i][col + j];
+        }
+    }
+    return res;
+}
+
+
+int main() {
+
+    {
+        Matrix a = RandomMatrix(6, 9);
+        MatrixView block = a.block(1, 2, 4, 5);
+        ASSERT_TRUE_MSG(block.rowsCount == 4 && block.columnsCount == 5, "Block dimensions")
+        ASSERT_TRUE_MSG(&block.get(0, 0) == &a[1][2] && &block[3][4] == &a[4][6], "A block refers to the matrix")
+        ASSERT_TRUE_MSG(block == Block(a, 1, 2, 4, 5), "Block elements")
+        ASSERT_TRUE_MSG(block.block(1, 1, 2, 2) == Block(a, 2, 3, 2, 2), "Block of a block")
+
+        ASSERT_TRUE_MSG(a.row(5) == Block(a, 5, 0, 1, 9), "row()")
+        ASSERT_TRUE_MSG(a.column(8) == Block(a, 0, 8, 6, 1), "column()")
+        ASSERT_TRUE_MSG(a.transposedView() == a.transposed(), "transposedView()")
+        ASSERT_TRUE_MSG(block.transposed().transposed() == block, "Transposing a view twice")
+        ASSERT_TRUE_MSG(block.transposed().row(1) == Block(a, 1, 3, 4, 1).transposed(), "Row of a transposed view")
+
+        auto column = a.getColumn(4);
+        ASSERT_TRUE_MSG(column.size() == 6 && &column[5] == &a[5][4], "getColumn() refers to the matrix")
+        column[2] = 100;
+        ASSERT_TRUE_MSG(a[2][4] == 100., "Writing through getColumn()")
+
+        ASSERT_EXCEPTION_MSG(a.block(3, 0, 4, 1), task::OutOfBoundsException, "Block past the last row")
+        ASSERT_EXCEPTION_MSG(a.block(0, 9, 1, 1), task::OutOfBoundsException, "Block past the last column")
+        ASSERT_EXCEPTION_MSG(block.get(4, 0), task::OutOfBoundsException, "get() out of the view")
+        ASSERT_EXCEPTION_MSG(a.row(6), task::OutOfBoundsException, "row() out of bounds")
+    }
+
+    {
+        // Views in arithmetic
+        Matrix a = RandomMatrix(8, 8);
+        Matrix b = RandomMatrix(8, 8);
+        const Matrix& constant = a;
+        ConstMatrixView left = constant.block(0, 0, 4, 8);
+        ConstMatrixView bottom = b.block(4, 0, 4, 8);
+
+        ASSERT_TRUE_MSG(Matrix(left + bottom) == Block(a, 0, 0, 4, 8) + Block(b, 4, 0, 4, 8), "Sum of views")
+        ASSERT_TRUE_MSG(Matrix(left * 2. - a.block(4, 0, 4, 8)) == Block(a, 0, 0, 4, 8) * 2. - Block(a, 4, 0, 4, 8), "Expression of views")
+        ASSERT_TRUE_MSG(left * b == Block(a, 0, 0, 4, 8) * b, "View times matrix")
+        ASSERT_TRUE_MSG(b * a.block(0, 0, 8, 3) == b * Block(a, 0, 0, 8, 3), "Matrix times view")
+        ASSERT_TRUE_MSG(a.transposedView() * b == a.transposed() * b, "Transposed view times matrix")
+        ASSERT_TRUE_MSG(left * bottom.transposed() == Block(a, 0, 0, 4, 8) * Block(b, 4, 0, 4, 8).transposed(), "Product of views")
+        ASSERT_EXCEPTION_MSG(left * bottom, task::SizeMismatchException, "Product of mismatched views")
+        ASSERT_EXCEPTION_MSG(Matrix(left + a), task::SizeMismatchException, "Sum of mismatched views")
+
+        Matrix sum = b;
+        sum += a.view();
+        ASSERT_TRUE_MSG(sum == a + b, "Matrix += view")
+    }
+
+    {
+        // Expressions reading the matrix they write out of place
+        Matrix a = RandomMatrix(5, 5);
+        Matrix b = RandomMatrix(5, 5);
+
+        Matrix square = a;
+        square = square.transposedView();
+        ASSERT_TRUE_MSG(square == a.transposed(), "a = a.transposedView() of a square matrix")
+
+        Matrix wide = RandomMatrix(2, 3);
+        Matrix wide_transposed = wide.transposed();
+        wide = wide.transposedView();
+        ASSERT_TRUE_MSG(wide.rowsCount == 3 && wide.columnsCount == 2 && wide == wide_transposed, "a = a.transposedView() of a 2x3 matrix")
+
+        Matrix sum = a;
+        sum = b + sum.transposedView();
+        ASSERT_TRUE_MSG(sum == b + a.transposed(), "a = b + a.transposedView()")
+
+        Matrix accumulated = a;
+        accumulated += accumulated.transposedView();
+        ASSERT_TRUE_MSG(accumulated == a + a.transposed(), "a += a.transposedView()")
+
+        Matrix reduced = a;
+        reduced -= reduced.transposedView() * 2.;
+        ASSERT_TRUE_MSG(reduced == a - a.transposed() * 2., "a -= a.transposedView() * factor")
+
+        Matrix shrunk = a;
+        shrunk = shrunk.block(1, 1, 3, 3);
+        ASSERT_TRUE_MSG(shrunk == Block(a, 1, 1, 3, 3), "a = block of a")
+
+        Matrix c = a;
+        MatrixView quarter = c.block(0, 0, 3, 3);
+        quarter.assign(quarter.transposed());
+        ASSERT_TRUE_MSG(Matrix(quarter) == Block(a, 0, 0, 3, 3).transposed(), "Assigning the transpose of a view to itself")
+        ASSERT_TRUE_MSG(Block(c, 3, 0, 2, 5) == Block(a, 3, 0, 2, 5), "Elements outside the view are kept")
+
+        Matrix shifted = a;
+        shifted.block(0, 0, 4, 4) += shifted.block(1, 1, 4, 4);
+        ASSERT_TRUE_MSG(Block(shifted, 0, 0, 4, 4) == Block(a, 0, 0, 4, 4) + Block(a, 1, 1, 4, 4), "Adding an overlapping block")
+
+        Matrix through = a;
+        through.transposedView().assign(through);
+        ASSERT_TRUE_MSG(through == a.transposed(), "Assigning a matrix to its transposed view")
+    }
+
+    for (size_t threads : {1, 3}) {
+        task::parallel::setThreadCount(threads);
+
+        // Large enough to go through the packed kernel and the thread pool
+        Matrix a = RandomMatrix(300, 200);
+        Matrix b = RandomMatrix(300, 150);
+        ASSERT_TRUE_MSG(a.transposedView() * b == a.transposed() * b, "A^T B without copying A")
+        ASSERT_TRUE_MSG(b.transposedView() * a.block(0, 10, 300, 120) == b.transposed() * Block(a, 0, 10, 300, 120), "B^T A_block")
+        Matrix d = RandomMatrix(260, 195);
+        ASSERT_TRUE_MSG(a.block(5, 5, 200, 190) * d.transposedView().block(0, 0, 190, 250)
+                        == Block(a, 5, 5, 200, 190) * Block(d.transposed(), 0, 0, 190, 250), "Block times transposed block")
+
+        // Writing through views, a blocked update of the top-left quarter
+        Matrix c = a;
+        MatrixView quarter = c.block(0, 0, 150, 100);
+        quarter.assign(quarter * 2.);
+        quarter += a.block(150, 100, 150, 100);
+        quarter -= a.block(0, 0, 150, 100);
+        ASSERT_TRUE_MSG(Matrix(quarter) == Block(a, 0, 0, 150, 100) + Block(a, 150, 100, 150, 100), "Writing a block")
+        ASSERT_TRUE_MSG(Block(c, 150, 0, 150, 200) == Block(a, 150, 0, 150, 200), "Elements outside the block are kept")
+        ASSERT_EXCEPTION_MSG(quarter.assign(a), task::SizeMismatchException, "Assigning a matrix of another size")
+
+        // Big enough for several sweep blocks, each reading rows the others write
+        Matrix e = a;
+        e = e.transposedView();
+        ASSERT_TRUE_MSG(e == a.transposed(), "a = a.transposedView() of 300x200")
+        e += e.transposedView().transposed();
+        ASSERT_TRUE_MSG(e == a.transposed() * 2., "a += a transposed twice")
+    }
+
+    std::cout << "All view tests passed!" << std::endl;
+    return 0;
+}